@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+#
+# Pack resources/factory_patches/*/*.sxsnp into resources/factory_bank.sxsfb, which is what
+# the plugin embeds. Run it from the repo root whenever a factory patch is added or edited
+# and commit the result alongside the xml.
+#
+# The bank is little endian:
+#   "SXFB", u32 format
+#   u32 n, then n x (u32 id, f32 value)       the most common value of each param in the bank
+#   u32 n, then n x index entry               category, file, version, name, where its pairs are
+#   the pairs                                 (u32 id, f32 value) where a patch differs from
+#                                             the common value, NaN meaning 'use the default'
+#
+# Strings are a u16 length then utf-8 bytes.
+
+import html
+import math
+import os
+import re
+import struct
+import sys
+from collections import Counter
+
+bankFormat = 1
+
+root = sys.argv[1] if len(sys.argv) > 1 else "."
+src = os.path.join(root, "resources", "factory_patches")
+dest = os.path.join(root, "resources", "factory_bank.sxsfb")
+
+headRE = re.compile(r'<patch id="([^"]*)" version="(\d+)"(?: name="([^"]*)")?><params>')
+paramRE = re.compile(r'<p id="(\d+)" v="([^"]*)" />')
+
+
+def f32(v):
+    return struct.unpack("<f", struct.pack("<f", float(v)))[0]
+
+
+def packString(s):
+    b = s.encode("utf-8")
+    return struct.pack("<H", len(b)) + b
+
+
+# not glob, which skips names starting with a dot
+files = sorted(os.path.join(src, c, f) for c in os.listdir(src) if os.path.isdir(os.path.join(src, c))
+               for f in os.listdir(os.path.join(src, c)) if f.endswith(".sxsnp"))
+
+patches = []
+for f in files:
+    with open(f, encoding="utf-8") as fh:
+        data = fh.read()
+    m = headRE.match(data)
+    if not m:
+        sys.exit(f"Can't read the patch header in {f}")
+    values = {int(pid): f32(v) for pid, v in paramRE.findall(data, m.end())}
+    patches.append({
+        "category": os.path.basename(os.path.dirname(f)),
+        "file": os.path.basename(f),
+        "version": int(m.group(2)),
+        "name": html.unescape(m.group(3) or ""),
+        "values": values,
+    })
+
+ids = sorted({pid for p in patches for pid in p["values"]})
+common = {}
+for pid in ids:
+    common[pid] = Counter(p["values"][pid] for p in patches if pid in p["values"]).most_common(1)[0][0]
+
+pairs = b""
+index = b""
+for p in patches:
+    diff = []
+    for pid in ids:
+        if pid not in p["values"]:
+            diff.append((pid, math.nan))
+        elif p["values"][pid] != common[pid]:
+            diff.append((pid, p["values"][pid]))
+    index += packString(p["category"]) + packString(p["file"])
+    index += struct.pack("<I", p["version"]) + packString(p["name"])
+    index += struct.pack("<II", len(pairs) // 8, len(diff))
+    for pid, v in diff:
+        pairs += struct.pack("<If", pid, v)
+
+out = b"SXFB" + struct.pack("<I", bankFormat)
+out += struct.pack("<I", len(ids))
+for pid in ids:
+    out += struct.pack("<If", pid, common[pid])
+out += struct.pack("<I", len(patches)) + index
+out += pairs
+
+with open(dest, "wb") as fh:
+    fh.write(out)
+
+print(f"Wrote {len(patches)} patches to {dest} in {len(out)} bytes")
@@ -115,19 +115,29 @@ bool get_metadata(const struct clap_preset_discovery_provider *provider, uint32_
         return true;
     }
 
-    fs::path p = fs::path{fs::u8path(location)};
-    p = p.replace_extension("");
-    p = p.filename();
+    fs::path full = fs::path{fs::u8path(location)};
+    auto name = full.filename().replace_extension("").u8string();
+    std::string desc = "A Six Sines User Preset";
 
-    SXSNLOG("Begin Preset " << p.u8string());
-    if (!mdr->begin_preset(mdr, p.u8string().c_str(), ""))
+    // served from the preset index so a rescan doesn't reopen every patch
+    auto entry = pm->pm.userPresetEntry(full);
+    if (entry.has_value())
+    {
+        if (!entry->name.empty())
+            name = entry->name;
+        if (!entry->category.empty())
+            desc += " in '" + entry->category + "'";
+    }
+
+    SXSNLOG("Begin Preset " << name);
+    if (!mdr->begin_preset(mdr, name.c_str(), ""))
     {
         SXSNLOG("Begin Preset failed");
         return false;
     }
     clap_universal_plugin_id_t clp{"clap", "org.baconpaul.six-sines"};
     mdr->add_plugin_id(mdr, &clp);
-    mdr->set_description(mdr, "A Six Sines User Preset");
+    mdr->set_description(mdr, desc.c_str());
 
     return true;
 }
@@ -16,6 +16,7 @@
 #include "configuration.h"
 #include <clap/clap.h>
 #include <chrono>
+#include <thread>
 
 #include <clap/helpers/plugin.hh>
 #include "synth/synth.h"
@@ -266,36 +267,80 @@ struct SixSinesClap : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     bool implementsState() const noexcept override { return true; }
     bool stateSave(const clap_ostream *ostream) noexcept override
     {
-        engine->mainToAudio.push({Synth::MainToAudioMsg::SEND_PREP_FOR_STREAM});
-        if (_host.canUseParams())
-            _host.paramsRequestFlush();
-
-        // best efforts on that message for now
-        static constexpr int maxIts{5};
-        int i{0};
-        for (i = 0; i < maxIts && !engine->readyForStream; ++i)
+        // The audio thread keeps a published copy of the patch. If a load or an edit hasn't
+        // reached it yet, catch up here when inactive, else have the engine publish
+        if (!isActive())
         {
-            using namespace std::chrono_literals;
-            std::this_thread::sleep_for(4ms);
+            if (engine->publishPendingStateWhileInactive() && _host.canUseParams())
+                _host.paramsRescan(CLAP_PARAM_RESCAN_VALUES);
         }
-        if (i == maxIts && !engine->readyForStream)
+        else if (engine->publishedStateIsBehind())
         {
-            // sigh. something is wonky
-            engine->prepForStream();
+            engine->statePublishRequested = true;
+            if (_host.canUseParams())
+                _host.paramsRequestFlush();
+
+            // a processing engine answers within a block, and a sleeping one on the flush
+            static constexpr int maxIts{5};
+            for (int i = 0; i < maxIts && engine->statePublishRequested; ++i)
+            {
+                using namespace std::chrono_literals;
+                std::this_thread::sleep_for(4ms);
+            }
         }
 
-        auto res = sst::plugininfra::patch_support::patchToOutStream(engine->patch, ostream);
-        engine->readyForStream = false;
-        return res;
+        // Sessions get the compact binary state; presets on disk stay XML
+        std::vector<float> values;
+        std::string name;
+        engine->readPublishedState(values, name);
+        auto state = engine->patch.toBinaryState(values, name.c_str());
+        engine->mainToAudio.push({Synth::MainToAudioMsg::SEND_PATCH_IS_CLEAN, true});
+
+        size_t written{0};
+        while (written < state.size())
+        {
+            auto w = ostream->write(ostream, state.data() + written, state.size() - written);
+            if (w <= 0)
+                return false;
+            written += w;
+        }
+        return true;
     }
     bool stateLoad(const clap_istream *istream) noexcept override
     {
-        Patch patchCopy;
-        if (!sst::plugininfra::patch_support::inStreamToPatch(istream, patchCopy))
+        std::string state;
+        char buffer[4096];
+        int64_t rd;
+        while ((rd = istream->read(istream, buffer, sizeof(buffer))) > 0)
+            state.append(buffer, rd);
+        if (rd < 0)
             return false;
 
-        presets::PresetManager::sendEntirePatchToAudio(patchCopy, engine->mainToAudio,
-                                                       patchCopy.name, _host.host());
+        // A current version session needs no migration, so skip building a whole Patch
+        std::vector<float> values;
+        std::string name;
+        if (!Patch::binaryStateToValues(state, values, name))
+        {
+            // Older binary sessions migrate through a Patch, and ones from before that are XML
+            Patch patchCopy;
+            if (Patch::isBinaryState(state))
+            {
+                if (!patchCopy.fromBinaryState(state))
+                    return false;
+            }
+            else if (!patchCopy.fromState(state))
+            {
+                return false;
+            }
+
+            values.clear();
+            for (const auto *p : patchCopy.params)
+                values.push_back(p->value);
+            name = patchCopy.name;
+        }
+
+        presets::PresetManager::sendValuesToAudio(std::move(values), engine->mainToAudio, name,
+                                                  _host.host());
         if (_host.canUseParams())
         {
             _host.paramsRescan(CLAP_PARAM_RESCAN_VALUES);
@@ -382,7 +427,7 @@ struct SixSinesClap : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     std::unique_ptr<juce::Component> createEditor() override
     {
         auto res = std::make_unique<baconpaul::six_sines::ui::SixSinesEditor>(
-            engine->audioToUi, engine->mainToAudio, _host.host());
+            engine->audioToUi, engine->uiParams, engine->mainToAudio, _host.host());
 
         res->onZoomChanged = [this](auto f)
         {
@@ -32,7 +32,8 @@ static constexpr size_t numOps{6};
 static constexpr size_t matrixSize{(numOps * (numOps - 1)) / 2};
 static constexpr size_t numMacros{6};
 
-static constexpr size_t maxVoices{64};
+static constexpr size_t maxVoices{256}; // the voice pool grows to at most this
+static constexpr size_t defaultVoiceLimit{64};
 
 static constexpr size_t numModsPer{3};
 
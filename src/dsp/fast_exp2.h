@@ -0,0 +1,69 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_DSP_FAST_EXP2_H
+#define BACONPAUL_SIX_SINES_DSP_FAST_EXP2_H
+
+#include "configuration.h"
+#include <sst/basic-blocks/simd/setup.h>
+
+namespace baconpaul::six_sines
+{
+/*
+ * 2^x four at a time. We split x = n + f with n = round(x) so f is in [-0.5, 0.5],
+ * evaluate 2^f with a degree 5 minimax polynomial (relative error 7.5e-8) and build
+ * 2^n directly in the exponent bits. In float the result is within 2.4e-7 relative
+ * of exp2, which is more accurate than the interpolated TwoToTheXProvider table and
+ * has no gathers so it vectorizes. x is clamped to [-126, 126] to stay normal.
+ */
+inline SIMD_M128 fastExp2(SIMD_M128 x)
+{
+    static constexpr float c0{1.0000000716546822f}, c1{0.693146967064733f},
+        c2{0.2402211972384865f}, c3{0.05550713273543075f}, c4{0.009675541334209831f},
+        c5{0.0013276471979286704f};
+
+    x = SIMD_MM(max_ps)(SIMD_MM(min_ps)(x, SIMD_MM(set1_ps)(126.f)), SIMD_MM(set1_ps)(-126.f));
+    auto n = SIMD_MM(cvtps_epi32)(x);
+    auto f = SIMD_MM(sub_ps)(x, SIMD_MM(cvtepi32_ps)(n));
+
+    auto r = SIMD_MM(add_ps)(SIMD_MM(set1_ps)(c4), SIMD_MM(mul_ps)(f, SIMD_MM(set1_ps)(c5)));
+    r = SIMD_MM(add_ps)(SIMD_MM(set1_ps)(c3), SIMD_MM(mul_ps)(f, r));
+    r = SIMD_MM(add_ps)(SIMD_MM(set1_ps)(c2), SIMD_MM(mul_ps)(f, r));
+    r = SIMD_MM(add_ps)(SIMD_MM(set1_ps)(c1), SIMD_MM(mul_ps)(f, r));
+    r = SIMD_MM(add_ps)(SIMD_MM(set1_ps)(c0), SIMD_MM(mul_ps)(f, r));
+
+    auto scale = SIMD_MM(castsi128_ps)(
+        SIMD_MM(slli_epi32)(SIMD_MM(add_epi32)(n, SIMD_MM(set1_epi32)(127)), 23));
+    return SIMD_MM(mul_ps)(r, scale);
+}
+
+// For the once-per-block callers, so they round the same way the block path does
+inline float fastExp2(float x) { return SIMD_MM(cvtss_f32)(fastExp2(SIMD_MM(set_ss)(x))); }
+
+// out[i] = 2^(scale * in[i]) - 1, the exponential FM curve. in and out may alias
+template <size_t N>
+inline void fastExp2MinusOneBlock(const float *in, float scale, float *out)
+{
+    static_assert(N % 4 == 0);
+    auto sc = SIMD_MM(set1_ps)(scale);
+    auto one = SIMD_MM(set1_ps)(1.f);
+    for (size_t i = 0; i < N; i += 4)
+    {
+        auto x = SIMD_MM(mul_ps)(SIMD_MM(load_ps)(in + i), sc);
+        SIMD_MM(store_ps)(out + i, SIMD_MM(sub_ps)(fastExp2(x), one));
+    }
+}
+} // namespace baconpaul::six_sines
+#endif // FAST_EXP2_H
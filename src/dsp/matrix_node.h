@@ -22,6 +22,7 @@
 #include "sst/basic-blocks/dsp/PanLaws.h"
 #include "sst/basic-blocks/dsp/DCBlocker.h"
 #include "dsp/op_source.h"
+#include "dsp/fast_exp2.h"
 #include "dsp/node_support.h"
 #include "synth/patch.h"
 #include "synth/mono_values.h"
@@ -39,14 +40,10 @@ struct MatrixNodeFrom : public EnvelopeSupport<Patch::MatrixNode>,
     const Patch::MatrixNode &matrixNode;
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
-    const float &level, &activeV, &modmodeV, &rmScaleV, &lfoToDepth, &envToLevel, &overdriveV;
     MatrixNodeFrom(const Patch::MatrixNode &mn, OpSource &on, OpSource &fr, MonoValues &mv,
                    const VoiceValues &vv)
-        : matrixNode(mn), monoValues(mv), voiceValues(vv), onto(on), from(fr), level(mn.level),
-          modmodeV(mn.modulationMode), activeV(mn.active), EnvelopeSupport(mn, mv, vv),
-          LFOSupport(mn, mv), lfoToDepth(mn.lfoToDepth), envToLevel(mn.envToLevel),
-          overdriveV(mn.overdrive), ModulationSupport(mn, this, mv, vv),
-          rmScaleV(mn.modulationScale)
+        : matrixNode(mn), monoValues(mv), voiceValues(vv), onto(on), from(fr),
+          EnvelopeSupport(mn, mv, vv), LFOSupport(mn, mv, vv), ModulationSupport(mn, this, mv, vv)
     {
     }
 
@@ -61,21 +58,17 @@ struct MatrixNodeFrom : public EnvelopeSupport<Patch::MatrixNode>,
         envResetMod();
         lfoResetMod();
 
-        active = activeV > 0.5;
+        active = matrixNode.active.value > 0.5;
 
-        modMode = (int)std::round(modmodeV);
-        rmScale = (int)std::round(rmScaleV);
+        modMode = matrixNode.plan.modMode;
+        rmScale = matrixNode.plan.rmScale;
         if (active)
         {
             bindModulation();
             calculateModulation();
             envAttack();
             lfoAttack();
-            overdriveFactor = overdriveV > 0.5 ? 10.0 : 1.0;
-            if (modMode == 3)
-            {
-                overdriveFactor = overdriveV > 0.5 ? 3.0 : 1.0;
-            }
+            overdriveFactor = matrixNode.plan.overdriveFactor;
         }
     }
 
@@ -92,30 +85,31 @@ struct MatrixNodeFrom : public EnvelopeSupport<Patch::MatrixNode>,
         // Construct the level which is lfo * lev + env * lev or + env * dept + lev
         if (lfoIsEnveloped)
         {
-            mech::scale_by<blockSize>(env.outputCache, lfo.outputBlock);
+            envScaleBlock(lfo.outputBlock);
         }
 
-        auto l2d = lfoToDepth * lfoAtten;
+        auto l2d = matrixNode.lfoToDepth.value * lfoAtten;
         static float la{-1111};
         if (la != lfoAtten)
         {
             la = lfoAtten;
         }
 
-        if (envIsMult)
+        auto e2d = (envIsMult ? matrixNode.level.value : matrixNode.envToLevel.value) * depthAtten;
+        auto lev = applyMod + (envIsMult ? 0.f : matrixNode.level.value);
+        if (envFlat)
         {
-            auto e2d = level * depthAtten;
+            lev += e2d * env.outputCache[0];
             for (int i = 0; i < blockSize; ++i)
             {
-                modlev[i] = applyMod + l2d * lfo.outputBlock[i] + e2d * env.outputCache[i];
+                modlev[i] = lev + l2d * lfo.outputBlock[i];
             }
         }
         else
         {
-            auto e2d = envToLevel * depthAtten;
             for (int i = 0; i < blockSize; ++i)
             {
-                modlev[i] = applyMod + level + l2d * lfo.outputBlock[i] + e2d * env.outputCache[i];
+                modlev[i] = lev + l2d * lfo.outputBlock[i] + e2d * env.outputCache[i];
             }
         }
 
@@ -149,6 +143,7 @@ struct MatrixNodeFrom : public EnvelopeSupport<Patch::MatrixNode>,
         else if (modMode == 2)
         {
             // linear FM. -1..1 with a 10x ocerdrivce
+            onto.fmAssigned = true;
             mech::mul_block<blockSize>(modlev, from.output, mod);
             for (int j = 0; j < blockSize; ++j)
             {
@@ -158,11 +153,10 @@ struct MatrixNodeFrom : public EnvelopeSupport<Patch::MatrixNode>,
         else if (modMode == 3)
         {
             // expoential fm. if mod is 0...1 the result is 2^mod - 1
+            onto.fmAssigned = true;
             mech::mul_block<blockSize>(modlev, from.output, mod);
-            for (int j = 0; j < blockSize; ++j)
-            {
-                onto.fmAmount[j] += monoValues.twoToTheX.twoToThe(overdriveFactor * mod[j]) - 1.0;
-            }
+            fastExp2MinusOneBlock<blockSize>(mod, overdriveFactor, mod);
+            mech::accumulate_from_to<blockSize>(mod, onto.fmAmount);
         }
         else
         {
@@ -184,53 +178,37 @@ struct MatrixNodeFrom : public EnvelopeSupport<Patch::MatrixNode>,
         lfoAtten = 1.f;
         applyMod = 0.f;
     }
-
-    bool checkLfoUsed() { return lfoToDepth != 0 || lfoUsedAsModulationSource; }
-
-    void calculateModulation()
+    void copyModulationFrom(const MatrixNodeFrom &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
+        depthAtten = o.depthAtten;
+        lfoAtten = o.lfoAtten;
+        applyMod = o.applyMod;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
 
-        if (!anySources)
-            return;
+    bool checkLfoUsed() { return matrixNode.lfoToDepth.value != 0 || lfoUsedAsModulationSource; }
 
-        for (int i = 0; i < numModsPer; ++i)
-        {
-            if (sourcePointers[i] &&
-                (int)matrixNode.modtarget[i].value != Patch::SelfNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled = envHandleModulationValue((int)matrixNode.modtarget[i].value, d,
-                                                        sourcePointers[i]) ||
-                               lfoHandleModulationValue((int)matrixNode.modtarget[i].value, d,
-                                                        sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((Patch::MatrixNode::TargetID)matrixNode.modtarget[i].value)
-                    {
-                    case Patch::MatrixNode::DIRECT:
-                        applyMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::MatrixNode::DEPTH_ATTEN:
-                        depthAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::MatrixNode::LFO_DEPTH_ATTEN:
-                        lfoAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-        }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
+
+        switch ((Patch::MatrixNode::TargetID)target)
+        {
+        case Patch::MatrixNode::DIRECT:
+            r.add(&applyMod);
+            return true;
+        case Patch::MatrixNode::DEPTH_ATTEN:
+            r.attenuate(&depthAtten);
+            return true;
+        case Patch::MatrixNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoAtten);
+            return true;
+        default:
+            break;
+        }
+        return false;
     }
 };
 
@@ -244,11 +222,9 @@ struct MatrixNodeSelf : EnvelopeSupport<Patch::SelfNode>,
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
 
-    const float &fbBase, &lfoToFB, &activeV, &envToFB, &overdriveV;
     MatrixNodeSelf(const Patch::SelfNode &sn, OpSource &on, MonoValues &mv, const VoiceValues &vv)
-        : selfNode(sn), monoValues(mv), voiceValues(vv), onto(on), fbBase(sn.fbLevel),
-          lfoToFB(sn.lfoToFB), activeV(sn.active), envToFB(sn.envToFB), overdriveV(sn.overdrive),
-          EnvelopeSupport(sn, mv, vv), LFOSupport(sn, mv), ModulationSupport(sn, this, mv, vv){};
+        : selfNode(sn), monoValues(mv), voiceValues(vv), onto(on), EnvelopeSupport(sn, mv, vv),
+          LFOSupport(sn, mv, vv), ModulationSupport(sn, this, mv, vv){};
     bool active{true}, lfoMul{false};
     float overdriveFactor{1.0};
 
@@ -258,14 +234,14 @@ struct MatrixNodeSelf : EnvelopeSupport<Patch::SelfNode>,
         envResetMod();
         lfoResetMod();
 
-        active = activeV > 0.5;
+        active = selfNode.active.value > 0.5;
         if (active)
         {
             bindModulation();
             calculateModulation();
             envAttack();
             lfoAttack();
-            overdriveFactor = overdriveV > 0.5 ? 10.0 : 1.0;
+            overdriveFactor = selfNode.plan.overdriveFactor;
         }
     }
     void applyBlock()
@@ -278,29 +254,28 @@ struct MatrixNodeSelf : EnvelopeSupport<Patch::SelfNode>,
         lfoProcess();
         if (lfoIsEnveloped)
         {
-            mech::scale_by<blockSize>(env.outputCache, lfo.outputBlock);
+            envScaleBlock(lfo.outputBlock);
         }
 
         float modlev alignas(16)[blockSize];
 
-        auto l2f = lfoToFB * lfoAtten;
+        auto l2f = selfNode.lfoToFB.value * lfoAtten;
 
-        if (envIsMult)
+        auto e2f = (envIsMult ? selfNode.fbLevel.value : selfNode.envToFB.value) * depthAtten;
+        auto fbBase = fbMod + (envIsMult ? 0.f : selfNode.fbLevel.value);
+        if (envFlat)
         {
-            auto e2f = fbBase * depthAtten;
-
+            fbBase += e2f * env.outputCache[0];
             for (int i = 0; i < blockSize; ++i)
             {
-                modlev[i] = l2f * lfo.outputBlock[i] + e2f * env.outputCache[i] + fbMod;
+                modlev[i] = fbBase + l2f * lfo.outputBlock[i];
             }
         }
         else
         {
-            auto e2f = envToFB * depthAtten;
-
             for (int i = 0; i < blockSize; ++i)
             {
-                modlev[i] = fbBase + l2f * lfo.outputBlock[i] + e2f * env.outputCache[i] + fbMod;
+                modlev[i] = fbBase + l2f * lfo.outputBlock[i] + e2f * env.outputCache[i];
             }
         }
         for (int j = 0; j < blockSize; ++j)
@@ -319,53 +294,37 @@ struct MatrixNodeSelf : EnvelopeSupport<Patch::SelfNode>,
         lfoAtten = 1.f;
         fbMod = 0.f;
     }
-    void calculateModulation()
+    void copyModulationFrom(const MatrixNodeSelf &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
-
-        if (!anySources)
-            return;
-
-        for (int i = 0; i < numModsPer; ++i)
-        {
-            if (sourcePointers[i] &&
-                (int)selfNode.modtarget[i].value != Patch::SelfNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled = envHandleModulationValue((int)selfNode.modtarget[i].value, d,
-                                                        sourcePointers[i]) ||
-                               lfoHandleModulationValue((int)selfNode.modtarget[i].value, d,
-                                                        sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((Patch::SelfNode::TargetID)selfNode.modtarget[i].value)
-                    {
-                    case Patch::SelfNode::DIRECT:
-                        fbMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::SelfNode::DEPTH_ATTEN:
-                        depthAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::SelfNode::LFO_DEPTH_ATTEN:
-                        lfoAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-        }
+        depthAtten = o.depthAtten;
+        lfoAtten = o.lfoAtten;
+        fbMod = o.fbMod;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
+
+        switch ((Patch::SelfNode::TargetID)target)
+        {
+        case Patch::SelfNode::DIRECT:
+            r.add(&fbMod);
+            return true;
+        case Patch::SelfNode::DEPTH_ATTEN:
+            r.attenuate(&depthAtten);
+            return true;
+        case Patch::SelfNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoAtten);
+            return true;
+        default:
+            break;
+        }
+        return false;
     }
 
-    bool checkLfoUsed() { return lfoToFB != 0 || lfoUsedAsModulationSource; }
+    bool checkLfoUsed() { return selfNode.lfoToFB.value != 0 || lfoUsedAsModulationSource; }
 };
 
 struct MixerNode : EnvelopeSupport<Patch::MixerNode>,
@@ -379,14 +338,11 @@ struct MixerNode : EnvelopeSupport<Patch::MixerNode>,
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
 
-    const float &level, &activeF, &pan, &lfoToLevel, &lfoToPan, &envToLevel;
     bool active{false};
 
     MixerNode(const Patch::MixerNode &mn, OpSource &f, MonoValues &mv, const VoiceValues &vv)
-        : mixerNode(mn), monoValues(mv), voiceValues(vv), from(f), pan(mn.pan), level(mn.level),
-          activeF(mn.active), lfoToLevel(mn.lfoToLevel), lfoToPan(mn.lfoToPan),
-          envToLevel(mn.envToLevel), EnvelopeSupport(mn, mv, vv), LFOSupport(mn, mv),
-          ModulationSupport(mn, this, mv, vv)
+        : mixerNode(mn), monoValues(mv), voiceValues(vv), from(f), EnvelopeSupport(mn, mv, vv),
+          LFOSupport(mn, mv, vv), ModulationSupport(mn, this, mv, vv)
     {
         memset(output, 0, sizeof(output));
     }
@@ -400,7 +356,7 @@ struct MixerNode : EnvelopeSupport<Patch::MixerNode>,
         envResetMod();
         lfoResetMod();
 
-        active = activeF > 0.5;
+        active = mixerNode.active.value > 0.5;
         memset(output, 0, sizeof(output));
         if (active)
         {
@@ -410,22 +366,15 @@ struct MixerNode : EnvelopeSupport<Patch::MixerNode>,
             lfoAttack();
 
             dcBlocker.reset();
-            memset(output, 0, sizeof(output));
-
-            auto wf = (SinTable::WaveForm)(from.waveForm);
-            if (wf == SinTable::TX3 || wf == SinTable::TX4 || wf == SinTable::TX7 ||
-                wf == SinTable::TX8 || wf == SinTable::SPIKY_TX4 || wf == SinTable::SPIKY_TX8)
-            {
-                doBlock = true;
-            }
+            doBlock = from.sourceNode.plan.dcBlocksOutput;
         }
     }
 
     bool checkLfoUsed()
     {
         auto used = lfoUsedAsModulationSource;
-        used = used || (lfoToLevel != 0);
-        used = used || (lfoToPan != 0);
+        used = used || (mixerNode.lfoToLevel.value != 0);
+        used = used || (mixerNode.lfoToPan.value != 0);
 
         return used;
     }
@@ -458,36 +407,37 @@ struct MixerNode : EnvelopeSupport<Patch::MixerNode>,
 
         if (lfoIsEnveloped)
         {
-            mech::scale_by<blockSize>(env.outputCache, lfo.outputBlock);
+            envScaleBlock(lfo.outputBlock);
         }
 
-        auto lv = std::clamp(level + levMod, 0.f, 1.f) * depthAtten;
+        auto lv = std::clamp(mixerNode.level.value + levMod, 0.f, 1.f) * depthAtten;
 
-        if (envIsMult)
+        auto e2l = envIsMult ? lv : mixerNode.envToLevel.value;
+        auto base = envIsMult ? 0.f : lv;
+        auto l2l = lfoAtten * mixerNode.lfoToLevel.value;
+        if (envFlat)
         {
+            base += e2l * env.outputCache[0];
             for (int j = 0; j < blockSize; ++j)
             {
-                // use mech blah
-                auto amp = lv * env.outputCache[j];
-                amp += lfoAtten * lfoToLevel * lfo.outputBlock[j];
-                vSum[j] = amp * useOut[j];
+                vSum[j] = (base + l2l * lfo.outputBlock[j]) * useOut[j];
             }
         }
         else
         {
             for (int j = 0; j < blockSize; ++j)
             {
-                // use mech blah
-                auto amp = lv + envToLevel * env.outputCache[j];
-                amp += lfoAtten * lfoToLevel * lfo.outputBlock[j];
+                auto amp = base + e2l * env.outputCache[j] + l2l * lfo.outputBlock[j];
                 vSum[j] = amp * useOut[j];
             }
         }
 
-        auto pn =
-            std::clamp(pan + lfoPanAtten * lfoToPan * lfo.outputBlock[blockSize - 1] +
-                           (from.unisonParticipatesPan ? voiceValues.uniPanShift : 0.f) + panMod,
-                       -1.f, 1.f);
+        auto pn = std::clamp(mixerNode.pan.value +
+                                 lfoPanAtten * mixerNode.lfoToPan.value *
+                                     lfo.outputBlock[blockSize - 1] +
+                                 (from.unisonParticipatesPan ? voiceValues.uniPanShift : 0.f) +
+                                 panMod,
+                             -1.f, 1.f);
         if (pn != 0.f)
         {
             pn = (pn + 1) * 0.5;
@@ -525,57 +475,43 @@ struct MixerNode : EnvelopeSupport<Patch::MixerNode>,
         panMod = 0.f;
         lfoPanAtten = 1.f;
     }
-
-    void calculateModulation()
+    void copyModulationFrom(const MixerNode &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
-
-        if (!anySources)
-            return;
+        depthAtten = o.depthAtten;
+        lfoAtten = o.lfoAtten;
+        levMod = o.levMod;
+        panMod = o.panMod;
+        lfoPanAtten = o.lfoPanAtten;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
 
-        for (int i = 0; i < numModsPer; ++i)
-        {
-            if (sourcePointers[i] &&
-                (int)mixerNode.modtarget[i].value != Patch::MixerNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled = envHandleModulationValue((int)mixerNode.modtarget[i].value, d,
-                                                        sourcePointers[i]) ||
-                               lfoHandleModulationValue((int)mixerNode.modtarget[i].value, d,
-                                                        sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((Patch::MixerNode::TargetID)mixerNode.modtarget[i].value)
-                    {
-                    case Patch::MixerNode::DIRECT:
-                        levMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::MixerNode::PAN:
-                        panMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::MixerNode::DEPTH_ATTEN:
-                        depthAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::MixerNode::LFO_DEPTH_ATTEN:
-                        lfoAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::MixerNode::LFO_DEPTH_PAN_ATTEN:
-                        lfoPanAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-        }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
+
+        switch ((Patch::MixerNode::TargetID)target)
+        {
+        case Patch::MixerNode::DIRECT:
+            r.add(&levMod);
+            return true;
+        case Patch::MixerNode::PAN:
+            r.add(&panMod);
+            return true;
+        case Patch::MixerNode::DEPTH_ATTEN:
+            r.attenuate(&depthAtten);
+            return true;
+        case Patch::MixerNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoAtten);
+            return true;
+        case Patch::MixerNode::LFO_DEPTH_PAN_ATTEN:
+            r.attenuate(&lfoPanAtten);
+            return true;
+        default:
+            break;
+        }
+        return false;
     }
 };
 
@@ -591,11 +527,9 @@ struct MainPanNode : EnvelopeSupport<Patch::MainPanNode>,
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
 
-    const float &lfoD, &envD;
-
     MainPanNode(const Patch::MainPanNode &mn, MonoValues &mv, const VoiceValues &vv)
-        : ModulationSupport(mn, this, mv, vv), EnvelopeSupport(mn, mv, vv), LFOSupport(mn, mv),
-          modNode(mn), monoValues(mv), voiceValues(vv), lfoD(mn.lfoDepth), envD(mn.envDepth)
+        : ModulationSupport(mn, this, mv, vv), EnvelopeSupport(mn, mv, vv), LFOSupport(mn, mv, vv),
+          modNode(mn), monoValues(mv), voiceValues(vv)
     {
     }
 
@@ -609,14 +543,9 @@ struct MainPanNode : EnvelopeSupport<Patch::MainPanNode>,
         bindModulation();
 
         active = true;
-        if (std::fabs(lfoD) < 1e-8 && std::fabs(envD) < 1e-8)
+        if (std::fabs(modNode.lfoDepth.value) < 1e-8 && std::fabs(modNode.envDepth.value) < 1e-8)
         {
-            active = false;
-            for (auto &d : sourcePointers)
-            {
-                if (d)
-                    active = true;
-            }
+            active = anyModulation();
         }
 
         level = 0.f;
@@ -646,8 +575,8 @@ struct MainPanNode : EnvelopeSupport<Patch::MainPanNode>,
             lfoLev = lfoLev * env.outBlock0;
         }
 
-        level = directMod + env.outBlock0 * (envD + edMod) * envAtten +
-                lfoLev * (lfoD + ldMod) * lfoAtten;
+        level = directMod + env.outBlock0 * (modNode.envDepth.value + edMod) * envAtten +
+                lfoLev * (modNode.lfoDepth.value + ldMod) * lfoAtten;
     }
 
     float lfoAtten{0.f};
@@ -664,59 +593,45 @@ struct MainPanNode : EnvelopeSupport<Patch::MainPanNode>,
         edMod = 0.f;
         ldMod = 0.f;
     }
-    void calculateModulation()
+    void copyModulationFrom(const MainPanNode &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
-
-        if (!anySources)
-            return;
-
-        for (int i = 0; i < numModsPer; ++i)
-        {
-            if (sourcePointers[i] &&
-                (int)modNode.modtarget[i].value != Patch::MainPanNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled =
-                    envHandleModulationValue((int)modNode.modtarget[i].value, d,
-                                             sourcePointers[i]) ||
-                    lfoHandleModulationValue((int)modNode.modtarget[i].value, d, sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((Patch::MainPanNode::TargetID)modNode.modtarget[i].value)
-                    {
-                    case Patch::MainPanNode::DIRECT:
-                        directMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::MainPanNode::ENVDEP_DIR:
-                        edMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::MainPanNode::LFODEP_DIR:
-                        ldMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::MainPanNode::DEPTH_ATTEN:
-                        envAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::MainPanNode::LFO_DEPTH_ATTEN:
-                        lfoAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-        }
+        lfoAtten = o.lfoAtten;
+        envAtten = o.envAtten;
+        directMod = o.directMod;
+        edMod = o.edMod;
+        ldMod = o.ldMod;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
+
+        switch ((Patch::MainPanNode::TargetID)target)
+        {
+        case Patch::MainPanNode::DIRECT:
+            r.add(&directMod);
+            return true;
+        case Patch::MainPanNode::ENVDEP_DIR:
+            r.add(&edMod);
+            return true;
+        case Patch::MainPanNode::LFODEP_DIR:
+            r.add(&ldMod);
+            return true;
+        case Patch::MainPanNode::DEPTH_ATTEN:
+            r.attenuate(&envAtten);
+            return true;
+        case Patch::MainPanNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoAtten);
+            return true;
+        default:
+            break;
+        }
+        return false;
     }
 
-    bool checkLfoUsed() { return lfoD != 0 || lfoUsedAsModulationSource; }
+    bool checkLfoUsed() { return modNode.lfoDepth.value != 0 || lfoUsedAsModulationSource; }
 };
 
 struct FineTuneNode : EnvelopeSupport<Patch::FineTuneNode>,
@@ -731,13 +646,9 @@ struct FineTuneNode : EnvelopeSupport<Patch::FineTuneNode>,
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
 
-    const float &lfoD, &envD, &coarseTune, &lfoCoarseD, &envCoarseD;
-
     FineTuneNode(const Patch::FineTuneNode &mn, MonoValues &mv, const VoiceValues &vv)
-        : ModulationSupport(mn, this, mv, vv), EnvelopeSupport(mn, mv, vv), LFOSupport(mn, mv),
-          coarseTune(mn.coarseTune), modNode(mn), monoValues(mv), voiceValues(vv),
-          lfoD(mn.lfoDepth), envD(mn.envDepth), lfoCoarseD(mn.lfoCoarseDepth),
-          envCoarseD(mn.envCoarseDepth)
+        : ModulationSupport(mn, this, mv, vv), EnvelopeSupport(mn, mv, vv), LFOSupport(mn, mv, vv),
+          modNode(mn), monoValues(mv), voiceValues(vv)
     {
     }
 
@@ -751,15 +662,11 @@ struct FineTuneNode : EnvelopeSupport<Patch::FineTuneNode>,
         bindModulation();
 
         active = true;
-        if (std::fabs(lfoD) < 1e-8 && std::fabs(envD) < 1e-8 && std::fabs(lfoCoarseD) < 1e-8 &&
-            std::fabs(envCoarseD) < 1e-8)
+        if (std::fabs(modNode.lfoDepth.value) < 1e-8 && std::fabs(modNode.envDepth.value) < 1e-8 &&
+            std::fabs(modNode.lfoCoarseDepth.value) < 1e-8 &&
+            std::fabs(modNode.envCoarseDepth.value) < 1e-8)
         {
-            active = false;
-            for (auto &d : sourcePointers)
-            {
-                if (d)
-                    active = true;
-            }
+            active = anyModulation();
         }
 
         level = 0.f;
@@ -790,11 +697,12 @@ struct FineTuneNode : EnvelopeSupport<Patch::FineTuneNode>,
             lfoLev = lfoLev * env.outBlock0;
         }
 
-        level = directMod + env.outBlock0 * (envD + edMod) * envAtten +
-                lfoLev * (lfoD + ldMod) * lfoAtten;
+        level = directMod + env.outBlock0 * (modNode.envDepth.value + edMod) * envAtten +
+                lfoLev * (modNode.lfoDepth.value + ldMod) * lfoAtten;
 
-        coarseLevel = directCoarseMod + env.outBlock0 * (envCoarseD + edMod) * envAtten +
-                      lfoLev * (lfoCoarseD + ldMod) * lfoAtten;
+        coarseLevel = directCoarseMod +
+                      env.outBlock0 * (modNode.envCoarseDepth.value + edMod) * envAtten +
+                      lfoLev * (modNode.lfoCoarseDepth.value + ldMod) * lfoAtten;
         coarseLevel *= 24;
     }
 
@@ -814,62 +722,53 @@ struct FineTuneNode : EnvelopeSupport<Patch::FineTuneNode>,
         edMod = 0.f;
         ldMod = 0.f;
     }
-    void calculateModulation()
+    void copyModulationFrom(const FineTuneNode &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
-
-        if (!anySources)
-            return;
-
-        for (int i = 0; i < numModsPer; ++i)
-        {
-            if (sourcePointers[i] &&
-                (int)modNode.modtarget[i].value != Patch::FineTuneNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled =
-                    envHandleModulationValue((int)modNode.modtarget[i].value, d,
-                                             sourcePointers[i]) ||
-                    lfoHandleModulationValue((int)modNode.modtarget[i].value, d, sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((int32_t)modNode.modtarget[i].value)
-                    {
-                    case Patch::FineTuneNode::DIRECT:
-                        directMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::FineTuneNode::ENVDEP_DIR:
-                        edMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::FineTuneNode::LFODEP_DIR:
-                        ldMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::FineTuneNode::DEPTH_ATTEN:
-                        envAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::FineTuneNode::LFO_DEPTH_ATTEN:
-                        lfoAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::FineTuneNode::COARSE:
-                        directCoarseMod += d * *sourcePointers[i];
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-        }
+        lfoAtten = o.lfoAtten;
+        envAtten = o.envAtten;
+        directMod = o.directMod;
+        directCoarseMod = o.directCoarseMod;
+        edMod = o.edMod;
+        ldMod = o.ldMod;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
+
+        switch ((int32_t)target)
+        {
+        case Patch::FineTuneNode::DIRECT:
+            r.add(&directMod);
+            return true;
+        case Patch::FineTuneNode::ENVDEP_DIR:
+            r.add(&edMod);
+            return true;
+        case Patch::FineTuneNode::LFODEP_DIR:
+            r.add(&ldMod);
+            return true;
+        case Patch::FineTuneNode::DEPTH_ATTEN:
+            r.attenuate(&envAtten);
+            return true;
+        case Patch::FineTuneNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoAtten);
+            return true;
+        case Patch::FineTuneNode::COARSE:
+            r.add(&directCoarseMod);
+            return true;
+        default:
+            break;
+        }
+        return false;
     }
 
-    bool checkLfoUsed() { return lfoD != 0 || lfoCoarseD != 0 || lfoUsedAsModulationSource; }
+    bool checkLfoUsed()
+    {
+        return modNode.lfoDepth.value != 0 || modNode.lfoCoarseDepth.value != 0 ||
+               lfoUsedAsModulationSource;
+    }
 };
 
 struct OutputNode : EnvelopeSupport<Patch::OutputNode>,
@@ -884,8 +783,6 @@ struct OutputNode : EnvelopeSupport<Patch::OutputNode>,
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
 
-    const float &level, &velSen, &bendUp, &bendDown, &octTranspose, &pan, &fineTune, &lfoDepth;
-    const float &defTrigV;
     TriggerMode defaultTrigger;
 
     MainPanNode panModNode;
@@ -895,10 +792,8 @@ struct OutputNode : EnvelopeSupport<Patch::OutputNode>,
                const Patch::FineTuneNode &ftMN, std::array<MixerNode, numOps> &f, MonoValues &mv,
                const VoiceValues &vv)
         : outputNode(on), ModulationSupport(on, this, mv, vv), monoValues(mv), voiceValues(vv),
-          fromArr(f), level(on.level), bendUp(on.bendUp), bendDown(on.bendDown),
-          octTranspose(on.octTranspose), velSen(on.velSensitivity), EnvelopeSupport(on, mv, vv),
-          LFOSupport(on, mv), defTrigV(on.defaultTrigger), pan(on.pan), fineTune(on.fineTune),
-          lfoDepth(on.lfoDepth), ftModNode(ftMN, mv, vv), panModNode(panMN, mv, vv)
+          fromArr(f), EnvelopeSupport(on, mv, vv), LFOSupport(on, mv, vv), ftModNode(ftMN, mv, vv),
+          panModNode(panMN, mv, vv)
     {
         memset(output, 0, sizeof(output));
         allowVoiceTrigger = false;
@@ -912,7 +807,7 @@ struct OutputNode : EnvelopeSupport<Patch::OutputNode>,
 
         memset(output, 0, sizeof(output));
 
-        defaultTrigger = (TriggerMode)std::round(defTrigV);
+        defaultTrigger = (TriggerMode)outputNode.plan.defaultTrigger;
         bindModulation();
         calculateModulation();
         envAttack();
@@ -939,27 +834,35 @@ struct OutputNode : EnvelopeSupport<Patch::OutputNode>,
         ftModNode.modProcess();
         panModNode.modProcess();
 
-        mech::copy_from_to<blockSize>(env.outputCache, finalEnvLevel);
-        mech::scale_by<blockSize>(depthAtten, finalEnvLevel);
+        if (envFlat)
+        {
+            std::fill(finalEnvLevel, finalEnvLevel + blockSize, env.outputCache[0] * depthAtten);
+        }
+        else
+        {
+            mech::copy_from_to<blockSize>(env.outputCache, finalEnvLevel);
+            mech::scale_by<blockSize>(depthAtten, finalEnvLevel);
+        }
 
         if (lfoIsEnveloped)
         {
-            mech::scale_by<blockSize>(env.outputCache, lfo.outputBlock);
+            envScaleBlock(lfo.outputBlock);
         }
 
-        auto l2f = lfoDepth * lfoAtten;
+        auto l2f = outputNode.lfoDepth.value * lfoAtten;
         mech::mul_block<blockSize>(lfo.outputBlock, l2f, lfo.outputBlock);
         mech::accumulate_from_to<blockSize>(lfo.outputBlock, finalEnvLevel);
 
         // push this into final env level so we dont traverse output twice then clients can use it
-        auto lv = std::clamp(level + levMod, 0.f, 1.f);
-        auto v = 1.f - velSen * (1.f - voiceValues.velocityLag.v);
+        auto lv = std::clamp(outputNode.level.value + levMod, 0.f, 1.f);
+        auto v = 1.f - outputNode.velSensitivity.value * (1.f - voiceValues.velocityLag.v);
         lv = 0.15 * std::clamp(v * lv * lv * lv, 0.f, 1.f);
         mech::scale_by<blockSize>(lv, finalEnvLevel);
 
         mech::scale_by<blockSize>(finalEnvLevel, output[0], output[1]);
 
-        auto pn = std::clamp(panMod + pan + panModNode.level + voiceValues.noteExpressionPanBipolar,
+        auto pn = std::clamp(panMod + outputNode.pan.value + panModNode.level +
+                                 voiceValues.noteExpressionPanBipolar,
                              -1.f, 1.f);
         ;
         if (pn != 0.f)
@@ -1001,56 +904,41 @@ struct OutputNode : EnvelopeSupport<Patch::OutputNode>,
         levMod = 0.f;
         lfoAtten = 1.f;
     }
-    void calculateModulation()
+    void copyModulationFrom(const OutputNode &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
-
-        if (!anySources)
-            return;
-
-        for (int i = 0; i < numModsPer; ++i)
-        {
-            if (sourcePointers[i] &&
-                (int)outputNode.modtarget[i].value != Patch::OutputNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled = envHandleModulationValue((int)outputNode.modtarget[i].value, d,
-                                                        sourcePointers[i]) ||
-                               lfoHandleModulationValue((int)outputNode.modtarget[i].value, d,
-                                                        sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((Patch::OutputNode::TargetID)outputNode.modtarget[i].value)
-                    {
-                    case Patch::OutputNode::PAN:
-                        panMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::OutputNode::DIRECT:
-                        levMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::OutputNode::DEPTH_ATTEN:
-                        depthAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::OutputNode::LFO_DEPTH_ATTEN:
-                        lfoAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-        }
+        depthAtten = o.depthAtten;
+        panMod = o.panMod;
+        levMod = o.levMod;
+        lfoAtten = o.lfoAtten;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
+
+        switch ((Patch::OutputNode::TargetID)target)
+        {
+        case Patch::OutputNode::PAN:
+            r.add(&panMod);
+            return true;
+        case Patch::OutputNode::DIRECT:
+            r.add(&levMod);
+            return true;
+        case Patch::OutputNode::DEPTH_ATTEN:
+            r.attenuate(&depthAtten);
+            return true;
+        case Patch::OutputNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoAtten);
+            return true;
+        default:
+            break;
+        }
+        return false;
     }
 
-    bool checkLfoUsed() { return lfoDepth != 0 || lfoUsedAsModulationSource; }
+    bool checkLfoUsed() { return outputNode.lfoDepth.value != 0 || lfoUsedAsModulationSource; }
 };
 } // namespace baconpaul::six_sines
 
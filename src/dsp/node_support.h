@@ -17,12 +17,14 @@
 #define BACONPAUL_SIX_SINES_DSP_NODE_SUPPORT_H
 
 #include <cstring>
+#include <limits>
 #include <string.h>
 
 #include "sst/cpputils/constructors.h"
 #include "sst/basic-blocks/modulators/AHDSRShapedSC.h"
 #include "sst/basic-blocks/modulators/SimpleLFO.h"
 #include "sst/basic-blocks/dsp/Lag.h"
+#include "sst/basic-blocks/mechanics/block-ops.h"
 
 #include "synth/mono_values.h"
 #include "synth/voice_values.h"
@@ -31,6 +33,7 @@
 namespace baconpaul::six_sines
 {
 namespace sdsp = sst::basic_blocks::dsp;
+namespace mech = sst::basic_blocks::mechanics;
 
 enum TriggerMode
 {
@@ -44,19 +47,48 @@ enum TriggerMode
 static const char *TriggerModeName[5]{"On Start or In Release (Legato)", "On Start Voice Only",
                                       "On Any Key Press", "Patch Default", "On Release"};
 
+/*
+ * One (source, depth, target) modulation slot, resolved when the slot changes. Offset
+ * routes compute dest = keep * dest + scale * depth * source, where keep is 0 for the
+ * envelope and lfo targets (which assign) and 1 for the rest (which accumulate).
+ * Attenuation routes compute dest *= 1 - depth * (1 - clamp(source, 0, 1)).
+ */
+struct ModRoute
+{
+    const float *source{nullptr};
+    const float *depth{nullptr};
+    float *dest{nullptr};
+    float scale{1.f};
+    float keep{1.f};
+    bool attenuates{false};
+
+    void add(float *d, float s = 1.f)
+    {
+        dest = d;
+        scale = s;
+        keep = 1.f;
+    }
+    void assign(float *d, float s = 1.f)
+    {
+        dest = d;
+        scale = s;
+        keep = 0.f;
+    }
+    void attenuate(float *d)
+    {
+        dest = d;
+        attenuates = true;
+    }
+};
+
 template <typename T> struct EnvelopeSupport
 {
+    const T &paramBundle;
     const MonoValues &monoValues;
     const VoiceValues &voiceValues;
 
-    const float &delay, &attackv, &hold, &decay, &sustain, &release, &powerV, &tmV, &emV, &oneShV,
-        &fromZV;
-    const float &ash, &dsh, &rsh;
     EnvelopeSupport(const T &mn, const MonoValues &mv, const VoiceValues &vv)
-        : monoValues(mv), voiceValues(vv), env(&mv.sr), delay(mn.delay), attackv(mn.attack),
-          hold(mn.hold), decay(mn.decay), sustain(mn.sustain), release(mn.release),
-          powerV(mn.envPower), ash(mn.aShape), dsh(mn.dShape), rsh(mn.rShape), tmV(mn.triggerMode),
-          emV(mn.envIsMultiplcative), oneShV(mn.envIsOneShot), fromZV(mn.envTriggersFromZero)
+        : paramBundle(mn), monoValues(mv), voiceValues(vv), env(&mv.sr)
     {
     }
 
@@ -65,9 +97,14 @@ template <typename T> struct EnvelopeSupport
     bool allowVoiceTrigger{true};
 
     bool active{true}, constantEnv{false};
+    // outputCache holds one value for the whole block, so consumers can broadcast it
+    bool envFlat{false};
+    float envFlatSustain{0.f};
     using range_t = sst::basic_blocks::modulators::TwentyFiveSecondExp;
     using env_t = sst::basic_blocks::modulators::AHDSRShapedSC<SRProvider, blockSize, range_t>;
     env_t env;
+    // the luts depend on the sample rate only, so build them once per rate not per attack
+    int64_t envLutGeneration{-1};
 
     float delayMod{0.f}, attackMod{0.f}, holdMod{0.f}, decayMod{0.f}, sustainMod{0.f},
         releaseMod{0.f};
@@ -78,21 +115,41 @@ template <typename T> struct EnvelopeSupport
     float minAttack{0.f};
     bool retriggerHasFloor{true};
 
+    // The patch value plus this voice's modulation, clamped the way the envelope wants it
+    float modDelay() const { return std::clamp(paramBundle.delay.value + delayMod, 0.f, 1.f); }
+    float modAttack() const
+    {
+        return std::clamp(paramBundle.attack.value + attackMod, minAttack, 1.f);
+    }
+    float modHold() const { return std::clamp(paramBundle.hold.value + holdMod, 0.f, 1.f); }
+    float modDecay() const { return std::clamp(paramBundle.decay.value + decayMod, 0.f, 1.f); }
+    float modSustain() const { return paramBundle.sustain.value + sustainMod; }
+    float modRelease() const
+    {
+        return std::clamp(paramBundle.release.value + releaseMod, 0.f, 1.f);
+    }
+
     void envAttack()
     {
-        triggerMode = (TriggerMode)std::round(tmV);
-        envIsMult = emV > 0.5;
-        envIsOneShot = oneShV > 0.5;
+        triggerMode = (TriggerMode)std::round(paramBundle.triggerMode.value);
+        envIsMult = paramBundle.envPlan.isMult;
+        envIsOneShot = paramBundle.envPlan.isOneShot;
         if (triggerMode == NEW_VOICE && !allowVoiceTrigger)
             triggerMode = NEW_GATE;
 
-        env.initializeLuts();
-        active = powerV > 0.5;
+        if (envLutGeneration != monoValues.sr.generation)
+        {
+            env.initializeLuts();
+            envLutGeneration = monoValues.sr.generation;
+        }
+        active = paramBundle.envPower.value > 0.5;
 
         auto mn = 0.0001;
         auto mx = 1 - mn;
 
-        if (decay < mn && attackv < mn && hold < mn && delay < mn && release > mx)
+        const auto &pb = paramBundle;
+        if (pb.decay.value < mn && pb.attack.value < mn && pb.hold.value < mn &&
+            pb.delay.value < mn && pb.release.value > mx)
         {
             constantEnv = true;
         }
@@ -112,6 +169,9 @@ template <typename T> struct EnvelopeSupport
                 (retriggerHasFloor && monoValues.attackFloorOnRetrig) ? minAttackOnRetrig : 0.f;
         }
 
+        envFlat = !active || constantEnv;
+        envFlatSustain = std::numeric_limits<float>::quiet_NaN();
+
         if (active && !constantEnv)
         {
             if (triggerMode == ON_RELEASE)
@@ -122,13 +182,12 @@ template <typename T> struct EnvelopeSupport
             else
             {
                 auto svs = startingValue;
-                if (fromZV > 0.5)
+                if (pb.envPlan.triggersFromZero)
                 {
                     startingValue = 0;
                 }
-                env.attackFromWithDelay(startingValue, std::clamp(delay + delayMod, 0.f, 1.f),
-                                        std::clamp(attackv + attackMod, minAttack, 1.f));
-                if (fromZV > 0.5)
+                env.attackFromWithDelay(startingValue, modDelay(), modAttack());
+                if (pb.envPlan.triggersFromZero)
                 {
                     static constexpr float dbs{1.f / blockSize};
                     auto v = 1.0;
@@ -143,7 +202,7 @@ template <typename T> struct EnvelopeSupport
         else if (constantEnv)
         {
             for (int i = 0; i < blockSize; ++i)
-                env.outputCache[i] = sustain;
+                env.outputCache[i] = pb.sustain.value;
         }
         else
             memset(env.outputCache, 0, sizeof(env.outputCache));
@@ -154,11 +213,14 @@ template <typename T> struct EnvelopeSupport
         if (!active || constantEnv)
             return;
 
+        const auto &pb = paramBundle;
+
         if (triggerMode == ON_RELEASE)
         {
             if (voiceValues.gated && !releaseEnvStarted)
             {
                 memset(env.outputCache, 0, sizeof(env.outputCache));
+                envFlat = true;
                 return;
             }
 
@@ -172,50 +234,56 @@ template <typename T> struct EnvelopeSupport
                 if (!releaseEnvStarted)
                 {
                     // never started - so attack from zero
-                    env.attackFromWithDelay(0.f, std::clamp(delay + delayMod, 0.f, 1.f),
-                                            std::clamp(attackv + attackMod, minAttack, 1.f));
+                    env.attackFromWithDelay(0.f, modDelay(), modAttack());
                     releaseEnvStarted = true;
                 }
                 else if (releaseEnvUngated)
                 {
-                    env.attackFromWithDelay(env.outputCache[blockSize - 1],
-                                            std::clamp(delay + delayMod, 0.f, 1.f),
-                                            std::clamp(attackv + attackMod, minAttack, 1.f));
+                    env.attackFromWithDelay(env.outputCache[blockSize - 1], modDelay(),
+                                            modAttack());
                     releaseEnvStarted = true;
                     releaseEnvUngated = false;
                 }
             }
-            env.processBlockWithDelay(std::clamp(delay + delayMod, 0.f, 1.f),
-                                      std::clamp(attackv + attackMod, minAttack, 1.f),
-                                      std::clamp(hold + holdMod, 0.f, 1.f),
-                                      std::clamp(decay + decayMod, 0.f, 1.f), sustain + sustainMod,
-                                      std::clamp(release + releaseMod, 0.f, 1.f), ash, dsh, rsh,
-                                      !voiceValues.gated, needsCurve);
+            env.processBlockWithDelay(modDelay(), modAttack(), modHold(), modDecay(), modSustain(),
+                                      modRelease(), pb.aShape.value, pb.dShape.value,
+                                      pb.rShape.value, !voiceValues.gated, needsCurve);
+            envFlat = false;
         }
         else
         {
             if (env.stage > env_t::s_release ||
-                (voiceValues.gated && (env.stage == env_t::s_sustain) && (sustain == 0.f)))
+                (voiceValues.gated && (env.stage == env_t::s_sustain) && (pb.sustain.value == 0.f)))
             {
                 memset(env.outputCache, 0, sizeof(env.outputCache));
                 env.output = 0;
                 env.outBlock0 = 0;
+                envFlat = true;
+                envFlatSustain = std::numeric_limits<float>::quiet_NaN();
                 return;
             }
 
             auto gate = envIsOneShot ? env.stage < env_t::s_sustain : voiceValues.gated;
-            env.processBlockWithDelay(std::clamp(delay + delayMod, 0.f, 1.f),
-                                      std::clamp(attackv + attackMod, minAttack, 1.f),
-                                      std::clamp(hold + holdMod, 0.f, 1.f),
-                                      std::clamp(decay + decayMod, 0.f, 1.f), sustain + sustainMod,
-                                      std::clamp(release + releaseMod, 0.f, 1.f), ash, dsh, rsh,
-                                      gate, needsCurve);
+            auto sus = modSustain();
+
+            // Held at an unmoving sustain the last block is already this block, so leave it
+            auto inSustain = gate && env.stage == env_t::s_sustain;
+            if (inSustain && envFlat && sus == envFlatSustain)
+                return;
+
+            env.processBlockWithDelay(modDelay(), modAttack(), modHold(), modDecay(), sus,
+                                      modRelease(), pb.aShape.value, pb.dShape.value,
+                                      pb.rShape.value, gate, needsCurve);
+            envFlat = inSustain && env.stage == env_t::s_sustain &&
+                      env.outputCache[0] == env.outputCache[blockSize - 1];
+            envFlatSustain = sus;
         }
     }
 
     void envCleanup()
     {
         memset(env.outputCache, 0, sizeof(env.outputCache));
+        envFlat = true;
         env.stage = env_t::s_complete;
         active = false;
     }
@@ -230,27 +298,46 @@ template <typename T> struct EnvelopeSupport
         releaseMod = 0.f;
     }
 
-    bool envHandleModulationValue(int target, const float depth, const float *source)
+    // onto *= env, as a broadcast multiply when the envelope is flat
+    void envScaleBlock(float *onto) const
+    {
+        if (envFlat)
+            mech::scale_by<blockSize>(env.outputCache[0], onto);
+        else
+            mech::scale_by<blockSize>(env.outputCache, onto);
+    }
+
+    void envCopyModFrom(const EnvelopeSupport &o)
+    {
+        delayMod = o.delayMod;
+        attackMod = o.attackMod;
+        holdMod = o.holdMod;
+        decayMod = o.decayMod;
+        sustainMod = o.sustainMod;
+        releaseMod = o.releaseMod;
+    }
+
+    bool envModRoute(int target, ModRoute &r)
     {
         switch (target)
         {
         case Patch::DAHDSRMixin::ENV_DELAY:
-            delayMod = depth * *source;
+            r.assign(&delayMod);
             return true;
         case Patch::DAHDSRMixin::ENV_ATTACK:
-            attackMod = depth * *source;
+            r.assign(&attackMod);
             return true;
         case Patch::DAHDSRMixin::ENV_HOLD:
-            holdMod = depth * *source;
+            r.assign(&holdMod);
             return true;
         case Patch::DAHDSRMixin::ENV_DECAY:
-            decayMod = depth * *source;
+            r.assign(&decayMod);
             return true;
         case Patch::DAHDSRMixin::ENV_SUSTAIN:
-            sustainMod = depth * *source;
+            r.assign(&sustainMod);
             return true;
         case Patch::DAHDSRMixin::ENV_RELEASE:
-            releaseMod = depth * *source;
+            r.assign(&releaseMod);
             return true;
         }
         return false;
@@ -262,18 +349,13 @@ template <typename Parent, typename T, bool needsSmoothing = true> struct LFOSup
     const T &paramBundle;
     const MonoValues &monoValues;
 
-    const float &lfoRate, &lfoDeform, &lfoShape, &lfoActiveV, &tempoSyncV, &bipolarV,
-        &lfoIsEnvelopedV, &lfoStartPhase;
     bool active, doSmooth{false};
     using lfo_t = sst::basic_blocks::modulators::SimpleLFO<SRProvider, blockSize>;
     lfo_t lfo;
     sst::basic_blocks::dsp::OnePoleLag<float, false> lag;
 
-    LFOSupport(const T &mn, MonoValues &mv)
-        : paramBundle(mn), lfo(&mv.sr, mv.rng), lfoRate(mn.lfoRate), lfoDeform(mn.lfoDeform),
-          lfoShape(mn.lfoShape), lfoActiveV(mn.lfoActive), tempoSyncV(mn.tempoSync), monoValues(mv),
-          bipolarV(mn.lfoBipolar), lfoIsEnvelopedV(mn.lfoIsEnveloped),
-          lfoStartPhase(mn.lfoStartPhase)
+    LFOSupport(const T &mn, MonoValues &mv, const VoiceValues &vv)
+        : paramBundle(mn), lfo(&mv.sr, vv.lfoRng), monoValues(mv)
     {
     }
 
@@ -292,13 +374,13 @@ template <typename Parent, typename T, bool needsSmoothing = true> struct LFOSup
         runLfo = static_cast<Parent *>(this)->checkLfoUsed();
         runLfoCheck = 0;
 
-        tempoSync = tempoSyncV > 0.5;
-        bipolar = bipolarV > 0.5;
-        lfoIsEnveloped = lfoIsEnvelopedV > 0.5;
-        shape = static_cast<int>(std::round(lfoShape));
+        tempoSync = paramBundle.lfoPlan.tempoSync;
+        bipolar = paramBundle.lfoPlan.bipolar;
+        lfoIsEnveloped = paramBundle.lfoPlan.isEnveloped;
+        shape = paramBundle.lfoPlan.shape;
 
         lfo.attack(shape);
-        lfo.applyPhaseOffset(lfoStartPhase + lfoStartMod);
+        lfo.applyPhaseOffset(paramBundle.lfoStartPhase.value + lfoStartMod);
         if (needsSmoothing)
         {
             auto tshape = (lfo_t::Shape)shape;
@@ -309,8 +391,7 @@ template <typename Parent, typename T, bool needsSmoothing = true> struct LFOSup
             case lfo_t::PULSE:
             case lfo_t::SH_NOISE:
                 doSmooth = true;
-                lag.setRateInMilliseconds(10, monoValues.sr.samplerate, 1.0);
-                lag.snapTo(0.f);
+                lag = monoValues.lfoSmoothLag;
                 break;
             default:
                 doSmooth = false;
@@ -335,7 +416,7 @@ template <typename Parent, typename T, bool needsSmoothing = true> struct LFOSup
             return;
         }
 
-        auto rate = lfoRate;
+        auto rate = paramBundle.lfoRate.value;
 
         if (tempoSync)
         {
@@ -344,8 +425,8 @@ template <typename Parent, typename T, bool needsSmoothing = true> struct LFOSup
 
         lfo.process_block(std::clamp(rate + lfoRateMod, paramBundle.lfoRate.meta.minVal,
                                      paramBundle.lfoRate.meta.maxVal),
-                          std::clamp(lfoDeform + lfoDeformMod, -1.f, 1.f), shape, false,
-                          tempoSync ? monoValues.tempoSyncRatio : 1.0);
+                          std::clamp(paramBundle.lfoDeform.value + lfoDeformMod, -1.f, 1.f),
+                          shape, false, tempoSync ? monoValues.tempoSyncRatio : 1.0);
 
         if constexpr (needsSmoothing)
         {
@@ -375,18 +456,25 @@ template <typename Parent, typename T, bool needsSmoothing = true> struct LFOSup
         lfoStartMod = 0.f;
     }
 
-    bool lfoHandleModulationValue(int target, const float depth, const float *source)
+    void lfoCopyModFrom(const LFOSupport &o)
+    {
+        lfoRateMod = o.lfoRateMod;
+        lfoDeformMod = o.lfoDeformMod;
+        lfoStartMod = o.lfoStartMod;
+    }
+
+    bool lfoModRoute(int target, ModRoute &r)
     {
         switch (target)
         {
         case Patch::LFOMixin::LFO_RATE:
-            lfoRateMod = depth * *source * 4;
+            r.assign(&lfoRateMod, 4.f);
             return true;
         case Patch::LFOMixin::LFO_DEFORM:
-            lfoDeformMod = depth * *source;
+            r.assign(&lfoDeformMod);
             return true;
         case Patch::LFOMixin::LFO_STARTPHASE:
-            lfoStartMod = depth * *source;
+            r.assign(&lfoStartMod);
             return true;
         }
         return false;
@@ -403,18 +491,65 @@ template <typename Bundle, typename Node> struct ModulationSupport
     // array makes ref clumsy so show pointers instead
     bool anySources{false};
     std::array<const float *, numModsPer> sourcePointers;
-    std::array<const float *, numModsPer> depthPointers;
-    std::array<float, numModsPer> priorModulation;
+    std::array<float, numModsPer> priorModulation, priorTarget;
+
+    std::array<ModRoute, numModsPer> offsetRoutes, attenRoutes;
+    int numOffsetRoutes{0}, numAttenRoutes{0};
 
     float modr01, modrpm1, modrnorm, modrhalfnorm;
 
     ModulationSupport(const Bundle &mn, Node *p, MonoValues &mv, const VoiceValues &vv)
-        : paramBundle(mn), enclosingNode(p), monoValues(mv), voiceValues(vv),
-          depthPointers(sst::cpputils::make_array_lambda<const float *, numModsPer>(
-              [this](int i) { return &paramBundle.moddepth[i].value; }))
+        : paramBundle(mn), enclosingNode(p), monoValues(mv), voiceValues(vv)
     {
         std::fill(sourcePointers.begin(), sourcePointers.end(), nullptr);
         std::fill(priorModulation.begin(), priorModulation.end(), 0.f);
+        std::fill(priorTarget.begin(), priorTarget.end(), 0.f);
+    }
+
+    /*
+     * Macros, MIDI CCs, channel AT and pitch bend are the same for every voice. The synth
+     * keeps one voice whose nodes bind only those (bindsMonoOnly) and runs their
+     * calculateModulation once a block; playing voices point monoNode at the matching node,
+     * bind only their polyphonic sources and start each block from the mono result.
+     */
+    const Node *monoNode{nullptr};
+    bool bindsMonoOnly{false};
+
+    static bool isMonoSource(int sv)
+    {
+        return (sv >= ModMatrixConfig::Source::MIDICC_0 &&
+                sv < ModMatrixConfig::Source::MIDICC_0 + 128) ||
+               (sv >= ModMatrixConfig::Source::MACRO_0 &&
+                sv < ModMatrixConfig::Source::MACRO_0 + numMacros) ||
+               sv == ModMatrixConfig::Source::CHANNEL_AT ||
+               sv == ModMatrixConfig::Source::PITCH_BEND;
+    }
+
+    bool bindsSource(int sv) const
+    {
+        if (bindsMonoOnly)
+            return isMonoSource(sv);
+        if (monoNode)
+            return !isMonoSource(sv);
+        return true;
+    }
+
+    // is anything modulating this node, including the mono sources we left to monoNode
+    bool anyModulation() const { return anySources || (monoNode && monoNode->anySources); }
+
+    void resetAllModulation()
+    {
+        auto *n = static_cast<Node *>(this);
+        if (monoNode)
+        {
+            n->copyModulationFrom(*monoNode);
+        }
+        else
+        {
+            n->resetModulation();
+            n->envResetMod();
+            n->lfoResetMod();
+        }
     }
 
     bool lfoUsedAsModulationSource{false};
@@ -422,32 +557,98 @@ template <typename Bundle, typename Node> struct ModulationSupport
     void bindModulation()
     {
         lfoUsedAsModulationSource = isLfoBoundToModulation();
+        rebindChangedModulation();
 
+        // the mono pass has no random sources and mustn't move the voices' rng stream
+        if (anySources && !bindsMonoOnly)
+            drawRandomSources();
+    }
+
+    // Rebuild the routes if a modsource or modtarget moved since the last look; true if so
+    bool rebindChangedModulation()
+    {
         bool changed{false};
         for (int i = 0; i < numModsPer; ++i)
         {
             if (priorModulation[i] != paramBundle.modsource[i].value)
             {
                 rebindPointer(i);
+                if (!bindsSource((int)std::round(paramBundle.modsource[i].value)))
+                    sourcePointers[i] = nullptr;
                 changed = true;
                 priorModulation[i] = paramBundle.modsource[i].value;
             }
-        }
-        if (changed)
-        {
-            anySources = false;
-            for (int i = 0; i < numModsPer; ++i)
+            if (priorTarget[i] != paramBundle.modtarget[i].value)
             {
-                anySources |= (sourcePointers[i] != nullptr);
+                changed = true;
+                priorTarget[i] = paramBundle.modtarget[i].value;
             }
         }
+        if (!changed)
+            return false;
 
-        if (anySources)
+        lfoUsedAsModulationSource = isLfoBoundToModulation();
+        anySources = false;
+        for (int i = 0; i < numModsPer; ++i)
+        {
+            anySources |= (sourcePointers[i] != nullptr);
+        }
+        compileModulationRoutes();
+        return true;
+    }
+
+    void drawRandomSources()
+    {
+        modr01 = monoValues.rng.unif01();
+        modrpm1 = monoValues.rng.unifPM1();
+        modrnorm = monoValues.rng.normPM1();
+        modrhalfnorm = monoValues.rng.half01();
+    }
+
+    void compileModulationRoutes()
+    {
+        numOffsetRoutes = 0;
+        numAttenRoutes = 0;
+        for (int i = 0; i < numModsPer; ++i)
+        {
+            if (!sourcePointers[i])
+                continue;
+
+            ModRoute r;
+            r.source = sourcePointers[i];
+            r.depth = &paramBundle.moddepth[i].value;
+            if (!static_cast<Node *>(this)->modRouteFor((int)paramBundle.modtarget[i].value, r))
+                continue;
+
+            if (r.attenuates)
+                attenRoutes[numAttenRoutes++] = r;
+            else
+                offsetRoutes[numOffsetRoutes++] = r;
+        }
+    }
+
+    void calculateModulation()
+    {
+        // a held note follows edits to its mod sources and targets; when nothing moved this
+        // is a compare per slot. A node which gains its first source mid note needs its own
+        // random values rather than whatever the last note left
+        auto hadSources = anySources;
+        if (rebindChangedModulation() && anySources && !hadSources && !bindsMonoOnly)
+            drawRandomSources();
+
+        resetAllModulation();
+
+        // attenuation and offset routes never share a destination so the order between
+        // the loops doesn't matter, but within the offset loop slot order does
+        for (int i = 0; i < numOffsetRoutes; ++i)
+        {
+            const auto &r = offsetRoutes[i];
+            *r.dest = r.keep * *r.dest + r.scale * *r.depth * *r.source;
+        }
+        for (int i = 0; i < numAttenRoutes; ++i)
         {
-            modr01 = monoValues.rng.unif01();
-            modrpm1 = monoValues.rng.unifPM1();
-            modrnorm = monoValues.rng.normPM1();
-            modrhalfnorm = monoValues.rng.half01();
+            const auto &r = attenRoutes[i];
+            *r.dest *= 1.f - *r.depth * (1.f - std::clamp(*r.source, 0.f, 1.f));
         }
     }
 
@@ -22,6 +22,7 @@
 #include "configuration.h"
 
 #include "dsp/sintable.h"
+#include "dsp/fast_exp2.h"
 #include "dsp/node_support.h"
 #include "synth/patch.h"
 #include "synth/mono_values.h"
@@ -38,6 +39,7 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
     float rmLevel alignas(16)[blockSize];
     float fmAmount alignas(16)[blockSize]; // in hz
     bool rmAssigned{false};
+    bool fmAssigned{false}; // a linear or exponential FM matrix node wrote fmAmount this block
 
     float output alignas(16)[blockSize];
 
@@ -46,14 +48,13 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
     const VoiceValues &voiceValues;
 
     bool keytrack{true};
-    const float &ratio, &activeV, &envToRatio, &lfoToRatio, &envToRatioFine,
-        &lfoToRatioFine; // in  frequency multiple
-    const float &waveForm, &kt, &ktv, &ktlo, &ktlov, &startPhase, &octTranspose; // in octaves;
     bool active{false};
     bool unisonParticipatesPan{true}, unisonParticipatesTune{true};
     bool operatorOutputsToMain{true}, operatorOutputsToOp{true};
 
     // todo waveshape
+    SinTable::Interpolation interpolation{SinTable::CUBIC_HERMITE};
+    bool polySin{false};
 
     uint32_t phase;
     int32_t dPhase;
@@ -62,14 +63,11 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
 
     OpSource(const Patch::SourceNode &sn, MonoValues &mv, const VoiceValues &vv)
         : sourceNode(sn), monoValues(mv), voiceValues(vv), EnvelopeSupport(sn, mv, vv),
-          LFOSupport(sn, mv), ModulationSupport(sn, this, mv, vv), ratio(sn.ratio),
-          activeV(sn.active), envToRatio(sn.envToRatio), lfoToRatio(sn.lfoToRatio),
-          waveForm(sn.waveForm), kt(sn.keyTrack), ktv(sn.keyTrackValue),
-          ktlo(sn.keyTrackValueIsLow), ktlov(sn.keyTrackLowFrequencyValue),
-          startPhase(sn.startingPhase), octTranspose(sn.octTranspose),
-          lfoToRatioFine(sn.lfoToRatioFine), envToRatioFine(sn.envToRatioFine)
+          LFOSupport(sn, mv, vv), ModulationSupport(sn, this, mv, vv)
     {
-        reset();
+        // No reset here. Pool voices are built on the main thread while audio runs, and
+        // reset touches the shared rng, lagging params and the plan, so Voice::attack does it.
+        // The LFO draws from the voice's own lfoRng for the same reason
     }
 
     float *lfoFacP{nullptr};
@@ -97,8 +95,10 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
             resetPhaseOnly();
             fbVal[0] = 0.f;
             fbVal[1] = 0.f;
-            auto wf = (SinTable::WaveForm)std::round(waveForm);
-            st.setWaveForm(wf);
+            const auto &plan = sourceNode.plan;
+            st.setWaveForm(plan.waveForm);
+            interpolation = plan.interpolation;
+            polySin = plan.polySin;
 
             if (lfoIsEnveloped)
             {
@@ -109,11 +109,11 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
                 lfoFacP = &one;
             }
 
-            unisonParticipatesPan = (int)(sourceNode.unisonParticipation.value) & 2;
-            unisonParticipatesTune = (int)(sourceNode.unisonParticipation.value) & 1;
+            unisonParticipatesPan = plan.unisonParticipatesPan;
+            unisonParticipatesTune = plan.unisonParticipatesTune;
 
-            auto u2m = (int)(sourceNode.unisonToMain.value);
-            auto u2op = (int)(sourceNode.unisonToOpOut.value);
+            auto u2m = plan.unisonToMain;
+            auto u2op = plan.unisonToOpOut;
 
             operatorOutputsToMain = true;
             if (u2m == 1)
@@ -144,8 +144,8 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
     bool checkLfoUsed()
     {
         auto used = lfoUsedAsModulationSource;
-        used = used || (lfoToRatio != 0);
-        used = used || (lfoToRatioFine != 0);
+        used = used || (sourceNode.lfoToRatio.value != 0);
+        used = used || (sourceNode.lfoToRatioFine.value != 0);
 
         return used;
     }
@@ -153,12 +153,12 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
     void resetPhaseOnly()
     {
         phase = 4 << 27;
-        unisonParticipatesTune = (int)(sourceNode.unisonParticipation.value) & 1;
+        unisonParticipatesTune = sourceNode.plan.unisonParticipatesTune;
         if (voiceValues.phaseRandom && unisonParticipatesTune)
         {
             phase += monoValues.rng.unifU32() & ((1 << 27) - 1);
         }
-        phase += (1 << 26) * (startPhase + phaseMod);
+        phase += (1 << 26) * (sourceNode.startingPhase.value + phaseMod);
     }
 
     void zeroInputs()
@@ -171,29 +171,31 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
             fmAmount[i] = 0.f;
         }
         rmAssigned = false;
+        fmAssigned = false;
     }
 
     void clearOutputs() { memset(output, 0, sizeof(output)); }
 
-    void snapActive() { active = activeV > 0.5; }
+    void snapActive() { active = sourceNode.active.value > 0.5; }
 
     float baseFrequency{0};
     void setBaseFrequency(float freq, float octFac)
     {
-        if (kt > 0.5)
+        if (sourceNode.plan.keyTrack)
         {
             baseFrequency = freq * octFac;
         }
         else
         {
-            if (ktlo > 0.5)
+            if (sourceNode.plan.keyTrackValueIsLow)
             {
-                baseFrequency = ktlov; // its just in hertz
+                baseFrequency = sourceNode.keyTrackLowFrequencyValue.value; // its just in hertz
             }
             else
             {
                 // Consciously do *not* retune absolute mode oscillators
-                baseFrequency = 440 * monoValues.twoToTheX.twoToThe(ktv / 12);
+                baseFrequency =
+                    440 * monoValues.twoToTheX.twoToThe(sourceNode.keyTrackValue.value / 12);
             }
         }
     }
@@ -224,13 +226,15 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
         lfoProcess();
         auto lfoFac = *lfoFacP;
 
-        auto rf = monoValues.twoToTheX.twoToThe(
-                      ratio +
-                      envRatioAtten * (envToRatio + centsScale * envToRatioFine) *
-                          env.outputCache[blockSize - 1] +
-                      lfoFac * lfoRatioAtten * (lfoToRatio + centsScale * lfoToRatioFine) *
-                          lfo.outputBlock[0] +
-                      ratioMod) *
+        const auto &sn = sourceNode;
+        auto rf = fastExp2(sn.ratio.value +
+                           envRatioAtten *
+                               (sn.envToRatio.value + centsScale * sn.envToRatioFine.value) *
+                               env.outputCache[blockSize - 1] +
+                           lfoFac * lfoRatioAtten *
+                               (sn.lfoToRatio.value + centsScale * sn.lfoToRatioFine.value) *
+                               lfo.outputBlock[0] +
+                           ratioMod) *
                   (unisonParticipatesTune ? voiceValues.uniRatioMul : 1.f);
 
         if (firstTime)
@@ -281,12 +285,76 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
 
     void innerLoop(float *onto, float *fbv, float rf, const float dRF, uint32_t &phs)
     {
-        for (int i = 0; i < blockSize; ++i)
+        if (polySin)
+        {
+            bool anyFb{false};
+            for (int i = 0; i < blockSize; ++i)
+                anyFb = anyFb || feedbackLevel[i] != 0;
+
+            if (!anyFb)
+            {
+                innerLoopPolySin(onto, fbv, rf, dRF, phs);
+                return;
+            }
+        }
+
+        switch (interpolation)
+        {
+        case SinTable::LINEAR:
+            innerLoopWith<SinTable::LINEAR>(onto, fbv, rf, dRF, phs);
+            break;
+        case SinTable::TRUNCATE:
+            innerLoopWith<SinTable::TRUNCATE>(onto, fbv, rf, dRF, phs);
+            break;
+        default:
+            innerLoopWith<SinTable::CUBIC_HERMITE>(onto, fbv, rf, dRF, phs);
+            break;
+        }
+    }
+
+    // Advance phs across the block, leaving the running phase for each sample in ph
+    void advancePhase(uint32_t *ph, float rf, const float dRF, uint32_t &phs)
+    {
+        if (fmAssigned)
         {
-            dPhase = st.dPhase((baseFrequency * (1.0 + fmAmount[i])) * rf);
-            rf += dRF;
+            for (int i = 0; i < blockSize; ++i)
+            {
+                dPhase = st.dPhase((baseFrequency * (1.0 + fmAmount[i])) * rf);
+                rf += dRF;
 
-            phs += dPhase;
+                phs += dPhase;
+                ph[i] = phs;
+            }
+            return;
+        }
+
+        // Without FM the increment is just a ramp in rf, so make it four at a time in float
+        // and integrate it with a prefix sum
+        static_assert(blockSize % 4 == 0);
+        auto k = (float)(baseFrequency * st.frToPhase);
+        auto kd = k * dRF;
+        auto ramp = SIMD_MM(mul_ps)(SIMD_MM(set1_ps)(kd), SIMD_MM(setr_ps)(0.f, 1.f, 2.f, 3.f));
+        auto acc = SIMD_MM(set1_epi32)((int32_t)phs);
+        for (int i = 0; i < blockSize; i += 4)
+        {
+            auto fr = SIMD_MM(add_ps)(SIMD_MM(set1_ps)(k * rf + i * kd), ramp);
+            auto d = SIMD_MM(cvttps_epi32)(fr);
+            d = SIMD_MM(add_epi32)(d, SIMD_MM(slli_si128)(d, 4));
+            d = SIMD_MM(add_epi32)(d, SIMD_MM(slli_si128)(d, 8));
+            SIMD_MM(store_si128)((SIMD_M128I *)(ph + i), SIMD_MM(add_epi32)(acc, d));
+            acc = SIMD_MM(set1_epi32)((int32_t)ph[i + 3]);
+        }
+        phs = ph[blockSize - 1];
+    }
+
+    template <SinTable::Interpolation interp>
+    void innerLoopWith(float *onto, float *fbv, float rf, const float dRF, uint32_t &phs)
+    {
+        uint32_t phb alignas(16)[blockSize];
+        advancePhase(phb, rf, dRF, phs);
+
+        for (int i = 0; i < blockSize; ++i)
+        {
             auto fb = 0.5 * (fbv[0] + fbv[1]);
             auto sb = std::signbit(feedbackLevel[i]);
             // fb = sb ? fb * fb : fb. Ugh a branch. but bool = 0/1, so
@@ -295,8 +363,8 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
             // fb * ( 1 - sb * ( 1 - fb)) - 2 mul 2 add
             fb = fb * (1 - sb * (1 - fb));
 
-            auto ph = phs + phaseInput[i] + (int32_t)(feedbackLevel[i] * fb);
-            auto out = st.at(ph);
+            auto ph = phb[i] + phaseInput[i] + (int32_t)(feedbackLevel[i] * fb);
+            auto out = st.atWith<interp>(ph);
 
             out = out * rmLevel[i];
             onto[i] = out;
@@ -305,6 +373,26 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
         }
     }
 
+    // With no feedback the phase doesn't depend on the output, so we can build the whole
+    // block of phases and then evaluate the sine four at a time without the table
+    void innerLoopPolySin(float *onto, float *fbv, float rf, const float dRF, uint32_t &phs)
+    {
+        static_assert(blockSize % 4 == 0);
+        uint32_t ph alignas(16)[blockSize];
+        advancePhase(ph, rf, dRF, phs);
+        for (int i = 0; i < blockSize; ++i)
+            ph[i] += phaseInput[i];
+
+        for (int i = 0; i < blockSize; i += 4)
+        {
+            auto out = SinTable::polySin4(SIMD_MM(load_si128)((SIMD_M128I *)(ph + i)));
+            out = SIMD_MM(mul_ps)(out, SIMD_MM(load_ps)(rmLevel + i));
+            SIMD_MM(store_ps)(onto + i, out);
+        }
+        fbv[1] = onto[blockSize - 2];
+        fbv[0] = onto[blockSize - 1];
+    }
+
     void resetModulation()
     {
         envRatioAtten = 1.f;
@@ -312,55 +400,41 @@ struct alignas(16) OpSource : public EnvelopeSupport<Patch::SourceNode>,
         ratioMod = 0.f;
         phaseMod = 0.f;
     }
-    void calculateModulation()
+    void copyModulationFrom(const OpSource &o)
     {
-        resetModulation();
-        envResetMod();
-        lfoResetMod();
-
-        if (!anySources)
-            return;
+        envRatioAtten = o.envRatioAtten;
+        lfoRatioAtten = o.lfoRatioAtten;
+        ratioMod = o.ratioMod;
+        phaseMod = o.phaseMod;
+        envCopyModFrom(o);
+        lfoCopyModFrom(o);
+    }
+    bool modRouteFor(int target, ModRoute &r)
+    {
+        if (envModRoute(target, r) || lfoModRoute(target, r))
+            return true;
 
-        for (int i = 0; i < numModsPer; ++i)
+        switch ((Patch::SourceNode::TargetID)target)
         {
-            if (sourcePointers[i] &&
-                (int)sourceNode.modtarget[i].value != Patch::SourceNode::TargetID::NONE)
-            {
-                // targets: env depth atten, lfo dept atten, direct adjust, env attack, lfo rate
-                auto dp = depthPointers[i];
-                if (!dp)
-                    continue;
-                auto d = *dp;
-
-                auto handled =
-                    envHandleModulationValue(sourceNode.modtarget[i].value, d, sourcePointers[i]) ||
-                    lfoHandleModulationValue(sourceNode.modtarget[i].value, d, sourcePointers[i]);
-
-                if (!handled)
-                {
-                    switch ((Patch::SourceNode::TargetID)sourceNode.modtarget[i].value)
-                    {
-                    case Patch::SourceNode::DIRECT:
-                        ratioMod += d * *sourcePointers[i] * 2;
-                        break;
-                    case Patch::SourceNode::DIRECT_FINE:
-                        ratioMod += d * *sourcePointers[i] * 2.0 / 12.0;
-                        break;
-                    case Patch::SourceNode::STARTING_PHASE:
-                        phaseMod += d * *sourcePointers[i];
-                        break;
-                    case Patch::SourceNode::ENV_DEPTH_ATTEN:
-                        envRatioAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    case Patch::SourceNode::LFO_DEPTH_ATTEN:
-                        lfoRatioAtten *= 1.0 - d * (1.0 - std::clamp(*sourcePointers[i], 0.f, 1.f));
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
+        case Patch::SourceNode::DIRECT:
+            r.add(&ratioMod, 2.f);
+            return true;
+        case Patch::SourceNode::DIRECT_FINE:
+            r.add(&ratioMod, 2.f / 12.f);
+            return true;
+        case Patch::SourceNode::STARTING_PHASE:
+            r.add(&phaseMod);
+            return true;
+        case Patch::SourceNode::ENV_DEPTH_ATTEN:
+            r.attenuate(&envRatioAtten);
+            return true;
+        case Patch::SourceNode::LFO_DEPTH_ATTEN:
+            r.attenuate(&lfoRatioAtten);
+            return true;
+        default:
+            break;
         }
+        return false;
     }
 
     SinTable st;
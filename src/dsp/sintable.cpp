@@ -29,6 +29,7 @@ SIMD_M128 SinTable::simdFullQuad alignas(
 SIMD_M128 SinTable::simdCubic alignas(16)[nPoints]; // it is cq, cq+1, cdq, cd1+1
 
 bool SinTable::staticsInitialized{false};
+bool SinTable::usePolynomialSin{SIX_SINES_POLYNOMIAL_SIN != 0};
 
 void SinTable::fillTable(int WF, std::function<std::pair<double, double>(double x, int Q)> der)
 {
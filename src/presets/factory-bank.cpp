@@ -0,0 +1,130 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#include "factory-bank.h"
+#include <cstring>
+#include "configuration.h"
+#include "synth/patch.h"
+
+namespace baconpaul::six_sines::presets
+{
+namespace
+{
+static constexpr uint32_t bankFormat{1};
+static constexpr size_t pairSize{sizeof(uint32_t) + sizeof(float)};
+
+struct Reader
+{
+    const char *data;
+    size_t size, pos{0};
+
+    template <typename T> bool get(T &v)
+    {
+        if (pos + sizeof(T) > size)
+            return false;
+        memcpy(&v, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool get(std::string &s)
+    {
+        uint16_t len;
+        if (!get(len) || pos + len > size)
+            return false;
+        s.assign(data + pos, len);
+        pos += len;
+        return true;
+    }
+
+    bool get(std::pair<uint32_t, float> &p) { return get(p.first) && get(p.second); }
+};
+} // namespace
+
+bool FactoryBank::read(const char *data, size_t size)
+{
+    entries.clear();
+    common.clear();
+
+    Reader r{data, size};
+    uint32_t format, n;
+    if (size < 4 || memcmp(data, "SXFB", 4) != 0)
+        return false;
+    r.pos = 4;
+    if (!r.get(format) || format != bankFormat || !r.get(n))
+    {
+        SXSNLOG("Unreadable factory bank");
+        return false;
+    }
+
+    common.resize(n);
+    for (auto &c : common)
+        if (!r.get(c))
+            return false;
+
+    if (!r.get(n))
+        return false;
+    entries.resize(n);
+    for (auto &e : entries)
+    {
+        if (!r.get(e.category) || !r.get(e.file) || !r.get(e.version) || !r.get(e.name) ||
+            !r.get(e.firstPair) || !r.get(e.pairCount))
+            return false;
+    }
+
+    pairs = data + r.pos;
+    pairsSize = size - r.pos;
+    for (const auto &e : entries)
+    {
+        if ((size_t)(e.firstPair + e.pairCount) * pairSize > pairsSize)
+            return false;
+    }
+    return true;
+}
+
+const FactoryBank::Entry *FactoryBank::find(const std::string &category,
+                                            const std::string &file) const
+{
+    for (const auto &e : entries)
+        if (e.category == category && e.file == file)
+            return &e;
+    return nullptr;
+}
+
+std::string FactoryBank::stateFor(const Entry &e) const
+{
+    // both lists are in id order so merge the patch's differences over the common values
+    Reader r{pairs + e.firstPair * pairSize, e.pairCount * pairSize};
+    std::vector<std::pair<uint32_t, float>> merged;
+    merged.reserve(common.size());
+
+    std::pair<uint32_t, float> diff;
+    auto haveDiff = r.get(diff);
+    for (const auto &c : common)
+    {
+        if (haveDiff && diff.first == c.first)
+        {
+            merged.push_back(diff);
+            haveDiff = r.get(diff);
+        }
+        else
+        {
+            merged.push_back(c);
+        }
+    }
+
+    return Patch::binaryStateFromPairs(e.version, e.name, merged);
+}
+} // namespace baconpaul::six_sines::presets
@@ -0,0 +1,55 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_PRESETS_FACTORY_BANK_H
+#define BACONPAUL_SIX_SINES_PRESETS_FACTORY_BANK_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace baconpaul::six_sines::presets
+{
+/*
+ * The factory patches as one embedded bank, built from resources/factory_patches by
+ * scripts/make_factory_bank.py. Reading it only decodes the name index; a patch's values
+ * are put together when it is loaded. See the script for the layout.
+ */
+struct FactoryBank
+{
+    struct Entry
+    {
+        std::string category, file, name;
+        uint32_t version{0};
+        uint32_t firstPair{0}, pairCount{0};
+    };
+    std::vector<Entry> entries;
+
+    // data must outlive the bank, which is fine for an embedded resource
+    bool read(const char *data, size_t size);
+
+    const Entry *find(const std::string &category, const std::string &file) const;
+
+    // A binary patch state for Patch::fromBinaryState, which migrates older versions
+    std::string stateFor(const Entry &e) const;
+
+  private:
+    std::vector<std::pair<uint32_t, float>> common;
+    const char *pairs{nullptr};
+    size_t pairsSize{0};
+};
+} // namespace baconpaul::six_sines::presets
+#endif // FACTORY_BANK_H
@@ -0,0 +1,560 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#include "preset-index.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "configuration.h"
+#include "synth/matrix_index.h"
+#include "synth/patch.h"
+
+namespace baconpaul::six_sines::presets
+{
+namespace
+{
+static constexpr const char *indexHeader{"SXSNIDX 2"};
+
+template <typename T> int64_t ticks(const T &t) { return (int64_t)t.time_since_epoch().count(); }
+
+std::string parentKey(const std::string &key)
+{
+    auto ps = key.rfind('/');
+    return ps == std::string::npos ? std::string() : key.substr(0, ps);
+}
+
+std::string leafOf(const std::string &key)
+{
+    auto ps = key.rfind('/');
+    return ps == std::string::npos ? key : key.substr(ps + 1);
+}
+
+// names go in a tab separated line so keep them to one field
+std::string oneField(std::string s)
+{
+    std::replace_if(
+        s.begin(), s.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return s;
+}
+} // namespace
+
+PresetIndex::Features PresetIndex::featuresOf(const Patch &patch)
+{
+    auto on = [](const Param &p) { return p.value > 0.5; };
+
+    Features f;
+    for (int i = 0; i < numOps; ++i)
+        if (on(patch.sourceNodes[i].active) && on(patch.mixerNodes[i].active) &&
+            patch.mixerNodes[i].level.value != 0)
+            f.ops |= 1 << i;
+
+    // then whatever modulates those, until nothing new turns up
+    for (int pass = 0; pass < numOps; ++pass)
+    {
+        auto before = f.ops;
+        for (size_t m = 0; m < matrixSize; ++m)
+        {
+            const auto &mn = patch.matrixNodes[m];
+            auto src = MatrixIndex::sourceIndexAt(m);
+            auto tgt = MatrixIndex::targetIndexAt(m);
+            if (!on(mn.active) || mn.level.value == 0 || !(f.ops & (1 << tgt)) ||
+                !on(patch.sourceNodes[src].active))
+                continue;
+            f.ops |= 1 << src;
+            f.modModes |= 1 << (int)std::round(mn.modulationMode.value);
+        }
+        if (f.ops == before)
+            break;
+    }
+
+    for (int i = 0; i < numOps; ++i)
+        if (f.ops & (1 << i))
+            f.waveforms |= 1u << (int)std::round(patch.sourceNodes[i].waveForm.value);
+
+    f.unison = (uint8_t)std::round(patch.output.unisonCount.value);
+    f.sampleRate = (uint8_t)std::round(patch.output.sampleRateStrategy.value);
+    return f;
+}
+
+PresetIndex &PresetIndex::instance()
+{
+    static PresetIndex idx;
+    return idx;
+}
+
+std::vector<fs::path> PresetIndex::scan(const fs::path &root, const fs::path &indexFile,
+                                        uint64_t *seq)
+{
+    std::unique_lock<std::mutex> lk(mutex);
+    std::vector<fs::path> res;
+    walk(lk, root, indexFile, &res);
+    if (seq)
+        *seq = changeSeq;
+    return res;
+}
+
+std::optional<std::vector<PresetIndex::Change>>
+PresetIndex::changesSince(const fs::path &root, const fs::path &indexFile, uint64_t &seq)
+{
+    std::unique_lock<std::mutex> lk(mutex);
+    walk(lk, root, indexFile, nullptr);
+    if (seq < changeFloor)
+        return std::nullopt;
+
+    std::vector<Change> res;
+    for (const auto &c : changeLog)
+        if (c.seq > seq)
+            res.push_back(c);
+    seq = changeSeq;
+    return res;
+}
+
+std::vector<std::optional<PresetIndex::Entry>>
+PresetIndex::cachedEntries(const std::vector<fs::path> &relPaths)
+{
+    std::lock_guard<std::mutex> g(mutex);
+    std::vector<std::optional<Entry>> res;
+    res.reserve(relPaths.size());
+    for (const auto &r : relPaths)
+    {
+        auto it = files.find(r.generic_u8string());
+        if (it == files.end())
+            res.emplace_back(std::nullopt);
+        else
+            res.emplace_back(it->second);
+    }
+    return res;
+}
+
+void PresetIndex::noteSaved(const fs::path &root, const fs::path &indexFile,
+                            const fs::path &relPath)
+{
+    auto full = root / relPath;
+    std::error_code ec;
+    auto mt = ticks(fs::last_write_time(full, ec));
+    if (ec)
+        return;
+    auto sz = (uint64_t)fs::file_size(full, ec);
+    if (ec)
+        return;
+
+    // read it before taking the lock, which a walk can hold while it lists the tree
+    auto e = readEntry(full, relPath, mt, sz);
+
+    std::lock_guard<std::mutex> g(mutex);
+    if (loadedFrom != indexFile)
+        load(indexFile);
+
+    auto key = relPath.generic_u8string();
+    files[key] = std::move(e);
+    dirty = true;
+
+    // a directory we haven't listed yet gets listed, with this in it, on the next walk
+    auto d = dirs.find(parentKey(key));
+    if (d != dirs.end())
+    {
+        auto leaf = leafOf(key);
+        auto &fl = d->second.files;
+        if (std::find(fl.begin(), fl.end(), leaf) == fl.end())
+        {
+            fl.push_back(leaf);
+            logChange(true, relPath);
+        }
+    }
+
+    // the next walk writes the index, on whichever thread is walking rather than this one
+}
+
+void PresetIndex::walk(std::unique_lock<std::mutex> &lk, const fs::path &root,
+                       const fs::path &indexFile, std::vector<fs::path> *out)
+{
+    if (loadedFrom != indexFile)
+        load(indexFile);
+
+    std::vector<PendingRead> reads;
+    try
+    {
+        scanDir(root, fs::path(), out, reads);
+    }
+    catch (fs::filesystem_error &e)
+    {
+        SXSNLOG("Preset scan error " << e.what());
+    }
+
+    // Parsing patches is the slow part, so let saves and other walks in while we do it
+    if (!reads.empty())
+    {
+        lk.unlock();
+        std::vector<Entry> entries;
+        entries.reserve(reads.size());
+        for (const auto &r : reads)
+            entries.push_back(readEntry(r.full, r.rel, r.mtime, r.size));
+        lk.lock();
+
+        for (size_t i = 0; i < reads.size(); ++i)
+            mergeEntry(reads[i].rel.generic_u8string(), std::move(entries[i]));
+    }
+
+    if (dirty)
+        save(lk, indexFile);
+}
+
+void PresetIndex::mergeEntry(const std::string &key, Entry &&e)
+{
+    // unless the patch went away while we read it, or someone stored a newer read
+    auto d = dirs.find(parentKey(key));
+    if (d == dirs.end())
+        return;
+    const auto &fl = d->second.files;
+    if (std::find(fl.begin(), fl.end(), leafOf(key)) == fl.end())
+        return;
+    auto it = files.find(key);
+    if (it != files.end() && it->second.mtime > e.mtime)
+        return;
+
+    files[key] = std::move(e);
+    dirty = true;
+}
+
+void PresetIndex::logChange(bool added, const fs::path &relPath)
+{
+    changeLog.push_back({++changeSeq, added, relPath});
+    while (changeLog.size() > maxChangeLog)
+    {
+        changeFloor = changeLog.front().seq;
+        changeLog.pop_front();
+    }
+}
+
+std::optional<PresetIndex::Entry> PresetIndex::entryFor(const fs::path &root,
+                                                        const fs::path &relPath)
+{
+    auto key = relPath.generic_u8string();
+    auto full = root / relPath;
+
+    std::error_code ec;
+    auto mt = ticks(fs::last_write_time(full, ec));
+    if (ec)
+        return std::nullopt;
+    auto sz = (uint64_t)fs::file_size(full, ec);
+    if (ec)
+        return std::nullopt;
+
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        auto it = files.find(key);
+        if (it != files.end() && it->second.mtime == mt && it->second.size == sz)
+            return it->second;
+    }
+
+    auto e = readEntry(full, relPath, mt, sz);
+    std::lock_guard<std::mutex> g(mutex);
+    files[key] = e;
+    dirty = true;
+    return e;
+}
+
+void PresetIndex::scanDir(const fs::path &root, const fs::path &rel, std::vector<fs::path> *out,
+                          std::vector<PendingRead> &reads)
+{
+    auto full = rel.empty() ? root : root / rel;
+    auto key = rel.generic_u8string();
+
+    std::error_code ec;
+    auto mt = ticks(fs::last_write_time(full, ec));
+    if (ec)
+        return;
+
+    // Adding, removing or renaming an entry moves the directory mtime so an unmoved one
+    // can come straight from the index
+    auto it = dirs.find(key);
+    if (it != dirs.end() && it->second.mtime == mt)
+    {
+        auto d = it->second;
+        for (const auto &f : d.files)
+        {
+            auto r = rel / fs::u8path(f);
+            if (out)
+                out->push_back(r);
+
+            // but saving over a patch in place doesn't, so each one still gets a stat
+            auto fp = root / r;
+            auto fmt = ticks(fs::last_write_time(fp, ec));
+            if (ec)
+                continue;
+            auto sz = (uint64_t)fs::file_size(fp, ec);
+            if (ec)
+                continue;
+            auto rk = r.generic_u8string();
+            auto fi = files.find(rk);
+            if (fi == files.end() || fi->second.mtime != fmt || fi->second.size != sz)
+                reads.push_back({fp, r, fmt, sz});
+        }
+        for (const auto &s : d.subdirs)
+            scanDir(root, rel / fs::u8path(s), out, reads);
+        return;
+    }
+
+    Dir d;
+    d.mtime = mt;
+    for (auto &el : fs::directory_iterator(full))
+    {
+        auto fn = el.path().filename();
+        if (el.is_directory(ec))
+        {
+            d.subdirs.push_back(fn.u8string());
+        }
+        else if (el.is_regular_file(ec) && fn.extension() == ".sxsnp")
+        {
+            d.files.push_back(fn.u8string());
+            auto r = rel / fn;
+            auto rk = r.generic_u8string();
+            auto fmt = ticks(el.last_write_time(ec));
+            auto sz = (uint64_t)el.file_size(ec);
+
+            auto fi = files.find(rk);
+            if (fi == files.end() || fi->second.mtime != fmt || fi->second.size != sz)
+                reads.push_back({el.path(), r, fmt, sz});
+            if (it == dirs.end() || std::find(it->second.files.begin(), it->second.files.end(),
+                                              fn.u8string()) == it->second.files.end())
+            {
+                logChange(true, r);
+            }
+            if (out)
+                out->push_back(r);
+        }
+    }
+
+    if (it != dirs.end())
+    {
+        auto prefix = key.empty() ? key : key + "/";
+        for (const auto &f : it->second.files)
+            if (std::find(d.files.begin(), d.files.end(), f) == d.files.end())
+            {
+                files.erase(prefix + f);
+                logChange(false, rel / fs::u8path(f));
+            }
+        for (const auto &s : it->second.subdirs)
+            if (std::find(d.subdirs.begin(), d.subdirs.end(), s) == d.subdirs.end())
+                forgetTree(prefix + s);
+    }
+
+    auto subs = d.subdirs;
+    dirs[key] = std::move(d);
+    dirty = true;
+
+    for (const auto &s : subs)
+        scanDir(root, rel / fs::u8path(s), out, reads);
+}
+
+void PresetIndex::forgetTree(const std::string &key)
+{
+    auto prefix = key + "/";
+    auto under = [&key, &prefix](const std::string &k)
+    { return k == key || k.compare(0, prefix.size(), prefix) == 0; };
+
+    for (auto it = dirs.begin(); it != dirs.end();)
+        it = under(it->first) ? dirs.erase(it) : std::next(it);
+    for (auto it = files.begin(); it != files.end();)
+    {
+        if (under(it->first))
+        {
+            logChange(false, fs::u8path(it->first));
+            it = files.erase(it);
+        }
+        else
+        {
+            it = std::next(it);
+        }
+    }
+}
+
+PresetIndex::Entry PresetIndex::readEntry(const fs::path &full, const fs::path &rel,
+                                          int64_t mtime, uint64_t size)
+{
+    Entry e;
+    e.mtime = mtime;
+    e.size = size;
+    e.category = rel.parent_path().generic_u8string();
+
+    std::ifstream t(full);
+    if (!t.is_open())
+        return e;
+    std::stringstream buffer;
+    buffer << t.rdbuf();
+    auto data = buffer.str();
+
+    // the stream writes its version on the root element, so the first one is ours
+    auto vp = data.find("version=\"");
+    if (vp != std::string::npos)
+        e.version = (uint32_t)std::strtoul(data.c_str() + vp + 9, nullptr, 10);
+
+    Patch patch;
+    patch.fromState(data);
+    e.name = oneField(patch.name);
+    e.features = featuresOf(patch);
+    return e;
+}
+
+void PresetIndex::load(const fs::path &indexFile)
+{
+    dirs.clear();
+    files.clear();
+    loadedFrom = indexFile;
+    dirty = false;
+
+    // whatever anyone had listed before is no longer something we can diff against
+    changeLog.clear();
+    changeFloor = ++changeSeq;
+
+    std::ifstream ifs(indexFile);
+    if (!ifs.is_open())
+        return;
+
+    std::string line;
+    if (!std::getline(ifs, line) || line != indexHeader)
+        return;
+
+    try
+    {
+        readLines(ifs);
+    }
+    catch (const std::exception &e)
+    {
+        // a damaged index just means one full scan
+        SXSNLOG("Ignoring preset index " << e.what());
+        dirs.clear();
+        files.clear();
+        return;
+    }
+
+    // the listings are implied by the keys so rebuild them rather than store them
+    for (const auto &[key, d] : dirs)
+        if (!key.empty())
+            dirs[parentKey(key)].subdirs.push_back(leafOf(key));
+    for (const auto &[key, f] : files)
+        dirs[parentKey(key)].files.push_back(leafOf(key));
+}
+
+void PresetIndex::readLines(std::istream &ifs)
+{
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        std::istringstream ls(line);
+        std::string kind, mt;
+        std::getline(ls, kind, '\t');
+        std::getline(ls, mt, '\t');
+        if (kind == "D")
+        {
+            std::string key;
+            std::getline(ls, key);
+            dirs[key].mtime = std::stoll(mt);
+        }
+        else if (kind == "F")
+        {
+            std::string sz, ver, key, ft;
+            Entry e;
+            e.mtime = std::stoll(mt);
+            std::getline(ls, sz, '\t');
+            std::getline(ls, ver, '\t');
+            std::getline(ls, key, '\t');
+            std::getline(ls, ft, '\t');
+            std::getline(ls, e.name);
+            e.size = std::stoull(sz);
+            e.version = (uint32_t)std::stoul(ver);
+
+            unsigned ops, waves, modes, uni, sr;
+            if (sscanf(ft.c_str(), "%x,%x,%x,%u,%u", &ops, &waves, &modes, &uni, &sr) != 5)
+                throw std::invalid_argument("Bad features for " + key);
+            e.features = {(uint8_t)ops, waves, (uint8_t)modes, (uint8_t)uni, (uint8_t)sr};
+            e.category = parentKey(key);
+            files[key] = std::move(e);
+        }
+    }
+}
+
+void PresetIndex::save(std::unique_lock<std::mutex> &lk, const fs::path &indexFile)
+{
+    auto text = indexText();
+    auto gen = ++saveGeneration;
+    dirty = false;
+
+    lk.unlock();
+    auto ok = writeIndex(indexFile, text, gen);
+    lk.lock();
+    if (!ok)
+        dirty = true;
+}
+
+bool PresetIndex::writeIndex(const fs::path &indexFile, const std::string &text, uint64_t gen)
+{
+    // two walks here can finish out of order, and the older listing mustn't land last
+    std::lock_guard<std::mutex> g(saveMutex);
+    if (gen < savedGeneration)
+        return true;
+
+    // Every instance in every process writes this file, so write a copy of our own and move
+    // it over the index whole. A reader then sees the old index or the new one, never part.
+    auto tmp = indexFile;
+    tmp += ".tmp" + std::to_string(std::random_device{}());
+    std::error_code ec;
+    {
+        std::ofstream ofs(tmp);
+        if (!ofs.is_open())
+            return false;
+        ofs << text;
+        ofs.close();
+        if (ofs.fail())
+        {
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmp, indexFile, ec);
+    if (ec)
+    {
+        SXSNLOG("Unable to replace preset index " << ec.message());
+        fs::remove(tmp, ec);
+        return false;
+    }
+    savedGeneration = gen;
+    return true;
+}
+
+std::string PresetIndex::indexText() const
+{
+    std::ostringstream ofs;
+
+    ofs << indexHeader << "\n";
+    for (const auto &[key, d] : dirs)
+        ofs << "D\t" << d.mtime << "\t" << key << "\n";
+    char ft[64];
+    for (const auto &[key, f] : files)
+    {
+        const auto &x = f.features;
+        snprintf(ft, sizeof(ft), "%x,%x,%x,%u,%u", (unsigned)x.ops, (unsigned)x.waveforms,
+                 (unsigned)x.modModes, (unsigned)x.unison, (unsigned)x.sampleRate);
+        ofs << "F\t" << f.mtime << "\t" << f.size << "\t" << f.version << "\t" << key << "\t"
+            << ft << "\t" << f.name << "\n";
+    }
+    return ofs.str();
+}
+} // namespace baconpaul::six_sines::presets
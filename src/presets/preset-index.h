@@ -0,0 +1,145 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_PRESETS_PRESET_INDEX_H
+#define BACONPAUL_SIX_SINES_PRESETS_PRESET_INDEX_H
+
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "filesystem/import.h"
+
+namespace baconpaul::six_sines
+{
+struct Patch;
+}
+
+namespace baconpaul::six_sines::presets
+{
+/*
+ * An on disk index of the user patch tree, shared by every PresetManager in the process
+ * (each editor and the discovery provider make one). A directory whose mtime hasn't moved
+ * since the last scan is taken from the index without listing it, though its patches are
+ * still stat'ed since saving over one in place leaves the directory alone. A patch is only
+ * re-read when its mtime or size changes.
+ */
+struct PresetIndex
+{
+    // What a patch does, for searching, worked out from its values when it is indexed
+    struct Features
+    {
+        uint8_t ops{0};        // bit per operator which is heard or modulates one which is
+        uint32_t waveforms{0}; // bit per SinTable::WaveForm on those operators
+        uint8_t modModes{0};   // bit per matrix modulation mode feeding those operators
+        uint8_t unison{1};
+        uint8_t sampleRate{0}; // the SampleRateStrategy
+    };
+    static Features featuresOf(const Patch &);
+
+    struct Entry
+    {
+        int64_t mtime{0};
+        uint64_t size{0};
+        uint32_t version{0};  // 0 if the file didn't say
+        std::string name;     // the name inside the patch, which can differ from the file
+        std::string category; // the directory relative to the root, empty at the top
+        Features features;
+    };
+
+    // A patch which appeared or went away, relative to the root
+    struct Change
+    {
+        uint64_t seq{0};
+        bool added{false};
+        fs::path relPath;
+    };
+
+    static PresetIndex &instance();
+
+    // Every patch under root, relative to it, updating and saving the index as we go. seq
+    // gets the change number this listing is current to.
+    std::vector<fs::path> scan(const fs::path &root, const fs::path &indexFile,
+                               uint64_t *seq = nullptr);
+
+    /*
+     * Walk the tree like scan but return only what changed after seq, moving seq on. Each
+     * PresetManager keeps its own seq so they can all apply the same changes. Nothing means
+     * seq is older than the changes kept and the caller should scan again.
+     */
+    std::optional<std::vector<Change>> changesSince(const fs::path &root,
+                                                    const fs::path &indexFile, uint64_t &seq);
+
+    // What the index holds for each of these, without going to disk
+    std::vector<std::optional<Entry>> cachedEntries(const std::vector<fs::path> &relPaths);
+
+    // We just wrote this patch, so list it now rather than trust a directory mtime which
+    // may not have ticked since the last look. The index file is left for the next walk.
+    void noteSaved(const fs::path &root, const fs::path &indexFile, const fs::path &relPath);
+
+    // One patch, refreshed from disk first if it changed since the last scan
+    std::optional<Entry> entryFor(const fs::path &root, const fs::path &relPath);
+
+  private:
+    struct Dir
+    {
+        int64_t mtime{0};
+        std::vector<std::string> subdirs, files;
+    };
+
+    std::mutex mutex;
+    fs::path loadedFrom;
+    bool dirty{false};
+    std::map<std::string, Dir> dirs;
+    std::map<std::string, Entry> files;
+
+    // changes after changeFloor are all in changeLog; older ones have been let go
+    static constexpr size_t maxChangeLog{4096};
+    std::deque<Change> changeLog;
+    uint64_t changeSeq{0}, changeFloor{0};
+    void logChange(bool added, const fs::path &relPath);
+
+    // a patch a walk found new or changed, read once the walk lets go of the lock
+    struct PendingRead
+    {
+        fs::path full, rel;
+        int64_t mtime{0};
+        uint64_t size{0};
+    };
+
+    // the index text is built under mutex and written under saveMutex, newest generation wins
+    std::mutex saveMutex;
+    uint64_t saveGeneration{0}, savedGeneration{0};
+
+    void load(const fs::path &indexFile);
+    void readLines(std::istream &);
+    void save(std::unique_lock<std::mutex> &lk, const fs::path &indexFile);
+    std::string indexText() const;
+    bool writeIndex(const fs::path &indexFile, const std::string &text, uint64_t gen);
+    void walk(std::unique_lock<std::mutex> &lk, const fs::path &root, const fs::path &indexFile,
+              std::vector<fs::path> *out);
+    void scanDir(const fs::path &root, const fs::path &rel, std::vector<fs::path> *out,
+                 std::vector<PendingRead> &reads);
+    void mergeEntry(const std::string &key, Entry &&e);
+    void forgetTree(const std::string &key);
+    static Entry readEntry(const fs::path &full, const fs::path &rel, int64_t mtime,
+                           uint64_t size);
+};
+} // namespace baconpaul::six_sines::presets
+#endif // PRESET_INDEX_H
@@ -46,22 +46,16 @@ PresetManager::PresetManager(const clap_host_t *ch) : clapHost(ch)
     try
     {
         auto fs = cmrc::sixsines_patches::get_filesystem();
-        for (const auto &d : fs.iterate_directory(factoryPath))
+        auto bank = fs.open(factoryBankPath);
+        factoryBank.read(bank.begin(), bank.size());
+
+        for (const auto &e : factoryBank.entries)
+            factoryPatchNames[e.category].push_back(e.file);
+        for (auto &[c, ents] : factoryPatchNames)
         {
-            if (d.is_directory())
-            {
-                std::vector<std::string> ents;
-                for (const auto &p :
-                     fs.iterate_directory(std::string() + factoryPath + "/" + d.filename()))
-                {
-                    ents.push_back(p.filename());
-                }
-
-                std::sort(ents.begin(), ents.end(),
-                          [](const auto &a, const auto &b)
-                          { return strnatcasecmp(a.c_str(), b.c_str()) < 0; });
-                factoryPatchNames[d.filename()] = ents;
-            }
+            std::sort(ents.begin(), ents.end(),
+                      [](const auto &a, const auto &b)
+                      { return strnatcasecmp(a.c_str(), b.c_str()) < 0; });
         }
 
         factoryPatchVector.clear();
@@ -83,64 +77,102 @@ PresetManager::PresetManager(const clap_host_t *ch) : clapHost(ch)
 
 PresetManager::~PresetManager() = default;
 
+std::optional<PresetIndex::Entry> PresetManager::userPresetEntry(const fs::path &full)
+{
+    auto rel = full.lexically_relative(userPatchesPath);
+    if (rel.empty() || *rel.begin() == "..")
+        return std::nullopt;
+    return PresetIndex::instance().entryFor(userPatchesPath, rel);
+}
+
+namespace
+{
+// Top level patches first by natural name, then the folders in path order
+bool userPatchLess(const fs::path &a, const fs::path &b)
+{
+    auto appe = a.parent_path().empty();
+    auto bppe = b.parent_path().empty();
+
+    if (appe && bppe)
+    {
+        return strnatcasecmp(a.filename().u8string().c_str(), b.filename().u8string().c_str()) <
+               0;
+    }
+    else if (appe)
+    {
+        return true;
+    }
+    else if (bppe)
+    {
+        return false;
+    }
+    else
+    {
+        return a < b;
+    }
+}
+} // namespace
+
 void PresetManager::rescanUserPresets()
 {
     userPatches.clear();
     try
     {
-        std::function<void(const fs::path &)> itd;
-        itd = [this, &itd](auto &p)
-        {
-            if (fs::is_directory(p))
-            {
-                for (auto &el : fs::directory_iterator(p))
-                {
-                    auto elp = el.path();
-                    if (elp.filename() == "." || elp.filename() == "..")
-                    {
-                        continue;
-                    }
-                    if (fs::is_directory(elp))
-                    {
-                        itd(elp);
-                    }
-                    else if (fs::is_regular_file(elp) && elp.extension() == ".sxsnp")
-                    {
-                        auto pushP = elp.lexically_relative(userPatchesPath);
-                        userPatches.push_back(pushP);
-                    }
-                }
-            }
-        };
-        itd(userPatchesPath);
-        std::sort(userPatches.begin(), userPatches.end(),
-                  [](const fs::path &a, const fs::path &b)
-                  {
-                      auto appe = a.parent_path().empty();
-                      auto bppe = b.parent_path().empty();
-
-                      if (appe && bppe)
-                      {
-                          return strnatcasecmp(a.filename().u8string().c_str(),
-                                               b.filename().u8string().c_str()) < 0;
-                      }
-                      else if (appe)
-                      {
-                          return true;
-                      }
-                      else if (bppe)
-                      {
-                          return false;
-                      }
-                      else
-                      {
-                          return a < b;
-                      }
-                  });
+        userPatches = PresetIndex::instance().scan(userPatchesPath, userPath / indexFileName,
+                                                   &userPatchesSeq);
+        std::sort(userPatches.begin(), userPatches.end(), userPatchLess);
     }
     catch (fs::filesystem_error &)
     {
     }
+    searchStale = true;
+}
+
+bool PresetManager::refreshUserPresets()
+{
+    auto found = userWatcher.take(userPatchesPath, userPath / indexFileName, userPatchesSeq);
+    if (!found.has_value())
+        return false;
+
+    if (found->listing.has_value())
+    {
+        userPatches = std::move(*found->listing);
+        std::sort(userPatches.begin(), userPatches.end(), userPatchLess);
+    }
+    for (const auto &c : found->changes)
+        applyUserPresetChange(c.added, c.relPath);
+
+    searchStale = true;
+    if (onUserPresetsChanged)
+        onUserPresetsChanged();
+    return true;
+}
+
+void PresetManager::applyUserPresetChange(bool added, const fs::path &relPath)
+{
+    // userPatches stays sorted so each change is a binary search and one insert or erase.
+    // Applying a change the list already has does nothing.
+    auto it = std::lower_bound(userPatches.begin(), userPatches.end(), relPath, userPatchLess);
+    auto present = it != userPatches.end() && *it == relPath;
+    if (added && !present)
+        userPatches.insert(it, relPath);
+    else if (!added && present)
+        userPatches.erase(it);
+}
+
+void PresetManager::noteUserPresetSaved(const fs::path &full)
+{
+    auto rel = full.lexically_relative(userPatchesPath);
+    if (rel.empty() || *rel.begin() == "..")
+        return;
+
+    // list it now; the watcher will report it too, which is harmless
+    PresetIndex::instance().noteSaved(userPatchesPath, userPath / indexFileName, rel);
+    applyUserPresetChange(true, rel);
+    searchStale = true;
+    if (onUserPresetsChanged)
+        onUserPresetsChanged();
+    userWatcher.poke();
 }
 
 #if USE_WCHAR_PRESET
@@ -153,7 +185,7 @@ void PresetManager::saveUserPresetDirect(Patch &patch, const wchar_t *fname)
         ofs << patch.toState();
     }
     ofs.close();
-    rescanUserPresets();
+    noteUserPresetSaved(fs::path(fname));
 }
 #else
 void PresetManager::saveUserPresetDirect(Patch &patch, const fs::path &pt)
@@ -165,23 +197,44 @@ void PresetManager::saveUserPresetDirect(Patch &patch, const fs::path &pt)
         ofs << patch.toState();
     }
     ofs.close();
-    rescanUserPresets();
+    noteUserPresetSaved(pt);
 }
 #endif
 
 void PresetManager::loadUserPresetDirect(Patch &patch, Synth::mainToAudioQueue_T &mainToAudio,
                                          const fs::path &p)
 {
-    std::ifstream t(p);
-    if (!t.is_open())
-        return;
-    std::stringstream buffer;
-    buffer << t.rdbuf();
+    auto dn = p.filename().replace_extension("").u8string();
+
+    int idx{-1};
+    for (int i = 0; i < userPatches.size(); ++i)
+    {
+        if (userPatchesPath / userPatches[i] == p)
+        {
+            idx = (int)factoryPatchVector.size() + i;
+            break;
+        }
+    }
+
+    auto parsed = prefetcher.take({nullptr, p});
+    if (parsed.has_value())
+    {
+        loadParsed(patch, mainToAudio, std::move(*parsed), dn);
+    }
+    else
+    {
+        std::ifstream t(p);
+        if (!t.is_open())
+            return;
+        std::stringstream buffer;
+        buffer << t.rdbuf();
 
-    patch.fromState(buffer.str());
+        patch.fromState(buffer.str());
+        sendEntirePatchToAudio(patch, mainToAudio, dn);
+    }
 
-    auto dn = p.filename().replace_extension("").u8string();
-    sendEntirePatchToAudio(patch, mainToAudio, dn);
+    if (idx >= 0)
+        prefetchAround(idx);
     if (onPresetLoaded)
         onPresetLoaded(dn);
 }
@@ -191,10 +244,9 @@ void PresetManager::loadFactoryPreset(Patch &patch, Synth::mainToAudioQueue_T &m
 {
     try
     {
-        auto fs = cmrc::sixsines_patches::get_filesystem();
-        auto f = fs.open(std::string() + factoryPath + "/" + cat + "/" + pat);
-        auto pb = std::string(f.begin(), f.end());
-        patch.fromState(pb);
+        auto ent = factoryBank.find(cat, pat);
+        if (!ent)
+            return;
 
         // can we find this factory preset
         int idx{0};
@@ -215,7 +267,18 @@ void PresetManager::loadFactoryPreset(Patch &patch, Synth::mainToAudioQueue_T &m
         {
             noExt = noExt.substr(0, ps);
         }
-        sendEntirePatchToAudio(patch, mainToAudio, noExt);
+
+        auto parsed = prefetcher.take({ent, {}});
+        if (parsed.has_value())
+        {
+            loadParsed(patch, mainToAudio, std::move(*parsed), noExt);
+        }
+        else
+        {
+            patch.fromBinaryState(factoryBank.stateFor(*ent));
+            sendEntirePatchToAudio(patch, mainToAudio, noExt);
+        }
+        prefetchAround(idx);
 
         if (onPresetLoaded)
         {
@@ -228,14 +291,115 @@ void PresetManager::loadFactoryPreset(Patch &patch, Synth::mainToAudioQueue_T &m
     }
 }
 
+std::vector<const PresetSearch::Row *> PresetManager::searchPresets(const std::string &query,
+                                                                    size_t maxResults)
+{
+    if (searchStale)
+        rebuildSearch();
+    return search.find(query, maxResults);
+}
+
+void PresetManager::rebuildSearch()
+{
+    auto stem = [](const fs::path &p) { return p.filename().replace_extension("").u8string(); };
+
+    // the factory set never changes so work out what those patches do just the once
+    if (factoryFeatures.size() != factoryPatchVector.size())
+    {
+        factoryFeatures.clear();
+        Patch scratch;
+        for (const auto &[cat, pat] : factoryPatchVector)
+        {
+            auto ent = factoryBank.find(cat, pat);
+            PresetIndex::Features f;
+            if (ent && scratch.fromBinaryState(factoryBank.stateFor(*ent)))
+                f = PresetIndex::featuresOf(scratch);
+            factoryFeatures.push_back(f);
+        }
+    }
+
+    search.clear();
+    int idx{0};
+    for (const auto &[cat, pat] : factoryPatchVector)
+    {
+        search.add(idx, cat, stem(pat), factoryFeatures[idx]);
+        idx++;
+    }
+
+    auto entries = PresetIndex::instance().cachedEntries(userPatches);
+    for (size_t i = 0; i < userPatches.size(); ++i)
+    {
+        const auto &up = userPatches[i];
+        search.add(idx++, up.parent_path().generic_u8string(), stem(up),
+                   entries[i].has_value() ? entries[i]->features : PresetIndex::Features());
+    }
+    searchStale = false;
+}
+
 void PresetManager::loadInit(Patch &patch, Synth::mainToAudioQueue_T &mainToAudio)
 {
     patch.resetToInit();
     sendEntirePatchToAudio(patch, mainToAudio, "Init");
+    prefetchAround(-1);
     if (onPresetLoaded)
         onPresetLoaded("Init");
 }
 
+void PresetManager::prefetchAround(int index)
+{
+    // only an editor steps through presets
+    if (!clapHost)
+        return;
+
+    std::vector<PresetPrefetcher::Source> sources;
+    for (int d = 1; d <= prefetchRadius; ++d)
+    {
+        for (auto i : {index + d, index - d})
+        {
+            auto s = prefetchSource(i);
+            if (s.has_value())
+                sources.push_back(std::move(*s));
+        }
+    }
+    prefetcher.want(sources);
+}
+
+std::optional<PresetPrefetcher::Source> PresetManager::prefetchSource(int index) const
+{
+    if (index < 0)
+        return std::nullopt;
+    if (index < factoryPatchVector.size())
+    {
+        const auto &[cat, pat] = factoryPatchVector[index];
+        auto ent = factoryBank.find(cat, pat);
+        if (!ent)
+            return std::nullopt;
+        return PresetPrefetcher::Source{ent, {}};
+    }
+    index -= factoryPatchVector.size();
+    if (index < userPatches.size())
+        return PresetPrefetcher::Source{nullptr, userPatchesPath / userPatches[index]};
+    return std::nullopt;
+}
+
+void PresetManager::loadParsed(Patch &patch, Synth::mainToAudioQueue_T &mainToAudio,
+                               PresetPrefetcher::Parsed &&parsed, const std::string &displayName)
+{
+    for (size_t i = 0; i < patch.params.size(); ++i)
+        patch.params[i]->value = parsed.values[i];
+    memset(patch.name, 0, sizeof(patch.name));
+    strncpy(patch.name, parsed.patchName.c_str(), sizeof(patch.name) - 1);
+
+    if (!clapHostParams)
+    {
+        clapHostParams = static_cast<const clap_host_params_t *>(
+            clapHost->get_extension(clapHost, CLAP_EXT_PARAMS));
+    }
+    // the parsed values move straight into the snapshot the audio thread applies
+    sendValuesToAudio(std::move(parsed.values), mainToAudio, displayName, clapHost,
+                      clapHostParams);
+}
+
 void PresetManager::sendEntirePatchToAudio(Patch &patch, Synth::mainToAudioQueue_T &mainToAudio,
                                            const std::string &s)
 {
@@ -250,6 +414,18 @@ void PresetManager::sendEntirePatchToAudio(Patch &patch, Synth::mainToAudioQueue
 void PresetManager::sendEntirePatchToAudio(Patch &patch, Synth::mainToAudioQueue_T &mainToAudio,
                                            const std::string &name, const clap_host_t *h,
                                            const clap_host_params_t *hostPar)
+{
+    std::vector<float> values;
+    values.reserve(patch.params.size());
+    for (const auto &p : patch.params)
+        values.push_back(p->value);
+    sendValuesToAudio(std::move(values), mainToAudio, name, h, hostPar);
+}
+
+void PresetManager::sendValuesToAudio(std::vector<float> &&values,
+                                      Synth::mainToAudioQueue_T &mainToAudio,
+                                      const std::string &name, const clap_host_t *h,
+                                      const clap_host_params_t *hostPar)
 {
     if (!h)
         return;
@@ -258,6 +434,18 @@ void PresetManager::sendEntirePatchToAudio(Patch &patch, Synth::mainToAudioQueue
     {
         hostPar = static_cast<const clap_host_params_t *>(h->get_extension(h, CLAP_EXT_PARAMS));
     }
+    // The audio thread owns the snapshot once it is pushed, and hands it back to
+    // Synth::onMainThread to be freed. If the queue is full it never got there, so it is
+    // ours, and nothing about the load goes after it
+    auto snap = new Synth::PatchSnapshot();
+    snap->values = std::move(values);
+    if (!mainToAudio.push({Synth::MainToAudioMsg::APPLY_PATCH_SNAPSHOT, 0, 0.f, nullptr, snap}))
+    {
+        SXSNLOG("Audio queue full; dropping patch snapshot");
+        delete snap;
+        return;
+    }
+
     static char stringBuffer[128][256];
     static int currentString{0};
 
@@ -267,13 +455,6 @@ void PresetManager::sendEntirePatchToAudio(Patch &patch, Synth::mainToAudioQueue
     memset(tmpDat, 0, 128 * sizeof(char));
     strncpy(tmpDat, name.c_str(), 255);
     mainToAudio.push({Synth::MainToAudioMsg::SEND_PATCH_NAME, 0, 0.f, tmpDat});
-    mainToAudio.push({Synth::MainToAudioMsg::STOP_AUDIO});
-    for (const auto &p : patch.params)
-    {
-        mainToAudio.push(
-            {Synth::MainToAudioMsg::SET_PARAM_WITHOUT_NOTIFYING, p->meta.id, p->value});
-    }
-    mainToAudio.push({Synth::MainToAudioMsg::START_AUDIO});
     mainToAudio.push({Synth::MainToAudioMsg::SEND_PATCH_IS_CLEAN, true});
     mainToAudio.push({Synth::MainToAudioMsg::SEND_POST_LOAD, true});
     mainToAudio.push({Synth::MainToAudioMsg::SEND_REQUEST_RESCAN, true});
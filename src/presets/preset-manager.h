@@ -18,6 +18,11 @@
 
 #include <clap/clap.h>
 #include "filesystem/import.h"
+#include "presets/factory-bank.h"
+#include "presets/preset-index.h"
+#include "presets/preset-prefetch.h"
+#include "presets/preset-search.h"
+#include "presets/preset-watch.h"
 #include "sst/jucegui/data/Discrete.h"
 #include "synth/patch.h"
 #include "synth/synth.h"
@@ -41,6 +46,20 @@ struct PresetManager
     ~PresetManager();
 
     void rescanUserPresets();
+    static constexpr const char *indexFileName{"PresetIndex.txt"};
+
+    // Apply what userWatcher found changed on disk to userPatches, without re-sorting.
+    // Cheap enough to call every idle; returns true and calls onUserPresetsChanged if
+    // anything moved.
+    bool refreshUserPresets();
+    std::function<void()> onUserPresetsChanged{nullptr};
+    uint64_t userPatchesSeq{0};
+    UserPresetWatcher userWatcher;
+    void applyUserPresetChange(bool added, const fs::path &relPath);
+    void noteUserPresetSaved(const fs::path &full);
+
+    // Index facts for a patch by full path, if it is under userPatchesPath
+    std::optional<PresetIndex::Entry> userPresetEntry(const fs::path &full);
 
     void loadInit(Patch &p, Synth::mainToAudioQueue_T &);
     void loadUserPresetDirect(Patch &, Synth::mainToAudioQueue_T &, const fs::path &p);
@@ -55,16 +74,38 @@ struct PresetManager
 
     std::function<void(const std::string &)> onPresetLoaded{nullptr};
 
-    static constexpr const char *factoryPath{"resources/factory_patches"};
+    static constexpr const char *factoryBankPath{"resources/factory_bank.sxsfb"};
+    FactoryBank factoryBank;
     std::map<std::string, std::vector<std::string>> factoryPatchNames;
     std::vector<std::pair<std::string, std::string>> factoryPatchVector;
     std::vector<fs::path> userPatches;
 
+    // the presets either side of the last load, in factoryPatchVector then userPatches order
+    PresetPrefetcher prefetcher{factoryBank};
+    static constexpr int prefetchRadius{1};
+    void prefetchAround(int index);
+    std::optional<PresetPrefetcher::Source> prefetchSource(int index) const;
+    void loadParsed(Patch &, Synth::mainToAudioQueue_T &, PresetPrefetcher::Parsed &&,
+                    const std::string &displayName);
+
+    // Factory and user presets matching a query; see PresetSearch for what one looks like.
+    // Row::index + 1 is the preset's value in the PresetDataBinding.
+    std::vector<const PresetSearch::Row *> searchPresets(const std::string &query,
+                                                         size_t maxResults);
+    PresetSearch search;
+    bool searchStale{true};
+    std::vector<PresetIndex::Features> factoryFeatures; // in factoryPatchVector order
+    void rebuildSearch();
+
     const clap_host_params_t *clapHostParams{nullptr};
     void sendEntirePatchToAudio(Patch &, Synth::mainToAudioQueue_T &, const std::string &name);
     static void sendEntirePatchToAudio(Patch &, Synth::mainToAudioQueue_T &,
                                        const std::string &name, const clap_host_t *,
                                        const clap_host_params_t *p = nullptr);
+    // values in Patch::paramTable order, for callers which never built a Patch
+    static void sendValuesToAudio(std::vector<float> &&values, Synth::mainToAudioQueue_T &,
+                                  const std::string &name, const clap_host_t *,
+                                  const clap_host_params_t *p = nullptr);
 };
 } // namespace baconpaul::six_sines::presets
 #endif // PRESET_MANAGER_H
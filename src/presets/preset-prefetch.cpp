@@ -0,0 +1,165 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#include "preset-prefetch.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "configuration.h"
+#include "synth/patch.h"
+
+namespace baconpaul::six_sines::presets
+{
+namespace
+{
+int64_t mtimeOf(const fs::path &p)
+{
+    std::error_code ec;
+    auto t = fs::last_write_time(p, ec);
+    return ec ? 0 : (int64_t)t.time_since_epoch().count();
+}
+} // namespace
+
+std::string PresetPrefetcher::Source::key() const
+{
+    if (factory)
+        return "factory:" + factory->category + "/" + factory->file;
+    return "user:" + path.u8string();
+}
+
+PresetPrefetcher::PresetPrefetcher(const FactoryBank &b) : bank(b) {}
+
+PresetPrefetcher::~PresetPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    if (worker)
+        worker->join();
+}
+
+void PresetPrefetcher::want(const std::vector<Source> &sources)
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        wanted.clear();
+        pending.clear();
+        for (const auto &s : sources)
+        {
+            auto k = s.key();
+            wanted.push_back(k);
+            if (ready.find(k) == ready.end())
+                pending.push_back(s);
+        }
+
+        for (auto it = ready.begin(); it != ready.end();)
+        {
+            auto keep = std::find(wanted.begin(), wanted.end(), it->first) != wanted.end();
+            it = keep ? std::next(it) : ready.erase(it);
+        }
+
+        if (!worker && !pending.empty())
+            worker = std::make_unique<std::thread>([this]() { run(); });
+    }
+    cv.notify_one();
+}
+
+std::optional<PresetPrefetcher::Parsed> PresetPrefetcher::take(const Source &source)
+{
+    std::optional<Parsed> res;
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        auto it = ready.find(source.key());
+        if (it == ready.end())
+            return std::nullopt;
+        res = std::move(it->second);
+        ready.erase(it);
+    }
+
+    // a user patch saved over since we read it has to be read again
+    if (!source.factory && mtimeOf(source.path) != res->mtime)
+        return std::nullopt;
+    return res;
+}
+
+void PresetPrefetcher::run()
+{
+    // one patch to parse into, made here so the editor doesn't wait on it
+    auto scratch = std::make_unique<Patch>();
+
+    std::unique_lock<std::mutex> lk(mutex);
+    while (true)
+    {
+        cv.wait(lk, [this]() { return stopping || !pending.empty(); });
+        if (stopping)
+            return;
+
+        auto source = std::move(pending.front());
+        pending.pop_front();
+        lk.unlock();
+
+        auto parsed = parse(*scratch, source);
+
+        lk.lock();
+        auto k = source.key();
+        if (parsed.has_value() && std::find(wanted.begin(), wanted.end(), k) != wanted.end())
+            ready[k] = std::move(*parsed);
+    }
+}
+
+std::optional<PresetPrefetcher::Parsed> PresetPrefetcher::parse(Patch &scratch,
+                                                                const Source &source)
+{
+    Parsed res;
+    try
+    {
+        if (source.factory)
+        {
+            auto state = bank.stateFor(*source.factory);
+            if (Patch::binaryStateToValues(state, res.values, res.patchName))
+                return res;
+
+            // older patches migrate through a Patch
+            if (!scratch.fromBinaryState(state))
+                return std::nullopt;
+        }
+        else
+        {
+            res.mtime = mtimeOf(source.path);
+            std::ifstream t(source.path);
+            if (!t.is_open())
+                return std::nullopt;
+            std::stringstream buffer;
+            buffer << t.rdbuf();
+
+            scratch.resetToInit();
+            scratch.fromState(buffer.str());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        SXSNLOG("Unable to prefetch " << source.key() << " " << e.what());
+        return std::nullopt;
+    }
+
+    res.values.reserve(scratch.params.size());
+    for (const auto *p : scratch.params)
+        res.values.push_back(p->value);
+    res.patchName = scratch.name;
+    return res;
+}
+} // namespace baconpaul::six_sines::presets
@@ -0,0 +1,87 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_PRESETS_PRESET_PREFETCH_H
+#define BACONPAUL_SIX_SINES_PRESETS_PRESET_PREFETCH_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "filesystem/import.h"
+#include "presets/factory-bank.h"
+
+namespace baconpaul::six_sines
+{
+struct Patch;
+}
+
+namespace baconpaul::six_sines::presets
+{
+/*
+ * Parses the presets either side of the one just loaded on a worker thread, so stepping
+ * through them with next / prev only copies values rather than reading and parsing a patch.
+ * The thread starts on the first request, so a read-only PresetManager never has one.
+ */
+struct PresetPrefetcher
+{
+    // A factory bank entry, or a user patch on disk when factory is null
+    struct Source
+    {
+        const FactoryBank::Entry *factory{nullptr};
+        fs::path path;
+
+        std::string key() const;
+    };
+
+    // A parsed patch, values in Patch::paramTable order
+    struct Parsed
+    {
+        std::vector<float> values;
+        std::string patchName;
+        int64_t mtime{0};
+    };
+
+    explicit PresetPrefetcher(const FactoryBank &b);
+    ~PresetPrefetcher();
+
+    // Keep these parsed, dropping anything else already parsed
+    void want(const std::vector<Source> &sources);
+
+    // The parse of source if it is ready and the file hasn't changed since
+    std::optional<Parsed> take(const Source &source);
+
+  private:
+    const FactoryBank &bank;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping{false};
+    std::deque<Source> pending;
+    std::vector<std::string> wanted;
+    std::map<std::string, Parsed> ready;
+    std::unique_ptr<std::thread> worker;
+
+    void run();
+    std::optional<Parsed> parse(Patch &scratch, const Source &source);
+};
+} // namespace baconpaul::six_sines::presets
+#endif // PRESET_PREFETCH_H
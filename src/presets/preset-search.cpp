@@ -0,0 +1,256 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#include "preset-search.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <sstream>
+#include "dsp/sintable.h"
+
+namespace baconpaul::six_sines::presets
+{
+namespace
+{
+// short names for the filters, in SinTable::WaveForm order
+static constexpr const char *waveNames[]{
+    "sin",    "sin5",   "square", "saw",      "triangle", "sincubed",     "tx2",
+    "tx3",    "tx4",    "tx5",    "tx6",      "tx7",      "tx8",          "spiky2",
+    "spiky4", "spiky6", "spiky8", "hann",     "blackman", "halfblackman", "tukey"};
+static_assert(std::size(waveNames) == SinTable::NUM_WAVEFORMS);
+
+// in modulationMode order
+static constexpr const char *modeNames[]{"pm", "ring", "lin", "exp"};
+
+// in SampleRateStrategy order
+static constexpr const char *rateNames[]{"110", "132", "176", "220"};
+
+std::string lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return (char)std::tolower(c); });
+    return s;
+}
+
+template <size_t N> uint32_t prefixMask(const char *const (&names)[N], const std::string &v)
+{
+    uint32_t res{0};
+    for (size_t i = 0; i < N; ++i)
+        if (std::string(names[i]).compare(0, v.size(), v) == 0)
+            res |= 1u << i;
+    return res;
+}
+
+uint32_t countBits(uint32_t v)
+{
+    uint32_t res{0};
+    for (; v; v &= v - 1)
+        res++;
+    return res;
+}
+
+struct Filter
+{
+    enum Kind
+    {
+        OPS,
+        WAVE,
+        MODE,
+        UNISON,
+        RATE
+    } kind;
+    uint32_t value;
+
+    bool matches(const PresetIndex::Features &f) const
+    {
+        switch (kind)
+        {
+        case OPS:
+            return countBits(f.ops) == value;
+        case WAVE:
+            return f.waveforms & value;
+        case MODE:
+            return f.modModes & value;
+        case UNISON:
+            return f.unison == value;
+        case RATE:
+            return (1u << f.sampleRate) & value;
+        }
+        return false;
+    }
+};
+
+// A 'key:value' term as a filter, or false to treat it as text
+bool parseFilter(const std::string &term, Filter &f)
+{
+    auto cp = term.find(':');
+    if (cp == std::string::npos || cp + 1 == term.size())
+        return false;
+    auto k = term.substr(0, cp);
+    auto v = term.substr(cp + 1);
+
+    if (k == "ops" || k == "uni")
+    {
+        if (v.size() > 3 ||
+            !std::all_of(v.begin(), v.end(), [](unsigned char c) { return std::isdigit(c); }))
+            return false;
+        f.kind = k == "ops" ? Filter::OPS : Filter::UNISON;
+        f.value = (uint32_t)std::stoul(v);
+        return true;
+    }
+
+    if (k == "wave")
+        f = {Filter::WAVE, prefixMask(waveNames, v)};
+    else if (k == "fm")
+        f = {Filter::MODE, prefixMask(modeNames, v)};
+    else if (k == "sr")
+        f = {Filter::RATE, prefixMask(rateNames, v)};
+    else
+        return false;
+    return true;
+}
+
+// A bit per letter or digit which appears, so most rows fail a term without looking at text
+uint64_t charMask(const std::string &s)
+{
+    uint64_t res{0};
+    for (unsigned char c : s)
+    {
+        if (c >= 'a' && c <= 'z')
+            res |= 1ull << (c - 'a');
+        else if (c >= '0' && c <= '9')
+            res |= 1ull << (26 + c - '0');
+        else
+            res |= 1ull << 36;
+    }
+    return res;
+}
+
+// 3 for a match at a word start, 2 anywhere, 1 for the letters in order with gaps, else 0
+int textScore(std::string_view hay, const std::string &term)
+{
+    auto pos = hay.find(term);
+    if (pos != std::string::npos)
+    {
+        for (; pos != std::string::npos; pos = hay.find(term, pos + 1))
+            if (pos == 0 || !std::isalnum((unsigned char)hay[pos - 1]))
+                return 3;
+        return 2;
+    }
+
+    size_t at{0};
+    for (auto c : term)
+    {
+        at = hay.find(c, at);
+        if (at == std::string::npos)
+            return 0;
+        at++;
+    }
+    return 1;
+}
+} // namespace
+
+void PresetSearch::clear()
+{
+    rows.clear();
+    chars.clear();
+    features.clear();
+    text.clear();
+    textStart.clear();
+}
+
+void PresetSearch::add(int index, const std::string &category, const std::string &name,
+                       const PresetIndex::Features &f)
+{
+    Row r;
+    r.index = index;
+    r.label = category.empty() ? name : category + "/" + name;
+
+    auto hay = lower(r.label);
+    chars.push_back(charMask(hay));
+    features.push_back(f);
+    textStart.push_back((uint32_t)text.size());
+    text += hay;
+    text.push_back(0);
+    rows.push_back(std::move(r));
+}
+
+std::vector<const PresetSearch::Row *> PresetSearch::find(const std::string &query,
+                                                          size_t maxResults) const
+{
+    std::vector<std::string> terms;
+    uint64_t termChars{0};
+    std::vector<Filter> filters;
+    std::istringstream qs(lower(query));
+    std::string t;
+    while (qs >> t)
+    {
+        Filter f;
+        if (parseFilter(t, f))
+            filters.push_back(f);
+        else
+        {
+            termChars |= charMask(t);
+            terms.push_back(t);
+        }
+    }
+
+    std::vector<std::pair<int, const Row *>> hits;
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        if ((chars[i] & termChars) != termChars)
+            continue;
+
+        auto ok{true};
+        for (const auto &fl : filters)
+            ok = ok && fl.matches(features[i]);
+        if (!ok)
+            continue;
+
+        auto end = i + 1 < rows.size() ? textStart[i + 1] - 1 : text.size() - 1;
+        auto hay = std::string_view(text).substr(textStart[i], end - textStart[i]);
+
+        int score{0};
+        for (const auto &term : terms)
+        {
+            auto s = textScore(hay, term);
+            if (s == 0)
+            {
+                ok = false;
+                break;
+            }
+            score += s;
+        }
+        if (ok)
+            hits.emplace_back(score, &rows[i]);
+    }
+
+    // best score first, then the order the presets step in
+    auto n = std::min(maxResults, hits.size());
+    std::partial_sort(hits.begin(), hits.begin() + n, hits.end(),
+                      [](const auto &a, const auto &b)
+                      {
+                          if (a.first != b.first)
+                              return a.first > b.first;
+                          return a.second->index < b.second->index;
+                      });
+
+    std::vector<const Row *> res;
+    res.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        res.push_back(hits[i].second);
+    return res;
+}
+} // namespace baconpaul::six_sines::presets
@@ -0,0 +1,61 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_PRESETS_PRESET_SEARCH_H
+#define BACONPAUL_SIX_SINES_PRESETS_PRESET_SEARCH_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "presets/preset-index.h"
+
+namespace baconpaul::six_sines::presets
+{
+/*
+ * Finds presets by name, folder and what they do. Each row keeps its text lower cased and
+ * its features as bits, so a query is one pass of substring tests and mask checks.
+ *
+ * A query is space separated terms which must all match. Plain words match the folder and
+ * name, as a substring or failing that in order with gaps (so 'brbs' finds 'Brass Bass').
+ * Filters are 'ops:3' (operators used), 'wave:saw', 'fm:ring' (pm, ring, lin, exp),
+ * 'uni:3' (unison voices) and 'sr:176' (oversampling rate).
+ */
+struct PresetSearch
+{
+    struct Row
+    {
+        int index{0}; // in factoryPatchVector then userPatches order, as the preset jog steps
+        std::string label;
+    };
+
+    void clear();
+    void add(int index, const std::string &category, const std::string &name,
+             const PresetIndex::Features &features);
+    size_t size() const { return rows.size(); }
+
+    // The best matching rows first, at most maxResults of them
+    std::vector<const Row *> find(const std::string &query, size_t maxResults) const;
+
+  private:
+    // what a query looks at is kept in flat arrays, apart from the labels it hands back
+    std::vector<Row> rows;
+    std::vector<uint64_t> chars;
+    std::vector<PresetIndex::Features> features;
+    std::string text; // every label lower cased, each followed by a nul
+    std::vector<uint32_t> textStart;
+};
+} // namespace baconpaul::six_sines::presets
+#endif // PRESET_SEARCH_H
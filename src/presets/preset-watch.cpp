@@ -0,0 +1,102 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#include "preset-watch.h"
+#include "configuration.h"
+
+namespace baconpaul::six_sines::presets
+{
+UserPresetWatcher::~UserPresetWatcher()
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    if (worker)
+        worker->join();
+}
+
+std::optional<UserPresetWatcher::Found>
+UserPresetWatcher::take(const fs::path &r, const fs::path &idx, uint64_t fromSeq)
+{
+    std::lock_guard<std::mutex> g(mutex);
+    if (!worker)
+    {
+        root = r;
+        indexFile = idx;
+        seq = fromSeq;
+        worker = std::make_unique<std::thread>([this]() { run(); });
+        return std::nullopt;
+    }
+
+    auto res = std::move(found);
+    found.reset();
+    return res;
+}
+
+void UserPresetWatcher::poke()
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        if (!worker)
+            return;
+        poked = true;
+    }
+    cv.notify_one();
+}
+
+void UserPresetWatcher::run()
+{
+    std::unique_lock<std::mutex> lk(mutex);
+    while (true)
+    {
+        cv.wait_for(lk, pollInterval, [this]() { return stopping || poked; });
+        if (stopping)
+            return;
+        poked = false;
+
+        auto s = seq;
+        lk.unlock();
+
+        Found f;
+        try
+        {
+            auto changes = PresetIndex::instance().changesSince(root, indexFile, s);
+            if (changes.has_value())
+                f.changes = std::move(*changes);
+            else
+                f.listing = PresetIndex::instance().scan(root, indexFile, &s);
+        }
+        catch (fs::filesystem_error &e)
+        {
+            SXSNLOG("User preset watch error " << e.what());
+        }
+
+        lk.lock();
+        seq = s;
+        if (f.listing.has_value() || !found.has_value())
+        {
+            // a listing supersedes whatever was waiting
+            if (f.listing.has_value() || !f.changes.empty())
+                found = std::move(f);
+        }
+        else
+        {
+            found->changes.insert(found->changes.end(), f.changes.begin(), f.changes.end());
+        }
+    }
+}
+} // namespace baconpaul::six_sines::presets
@@ -0,0 +1,71 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_PRESETS_PRESET_WATCH_H
+#define BACONPAUL_SIX_SINES_PRESETS_PRESET_WATCH_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "filesystem/import.h"
+#include "presets/preset-index.h"
+
+namespace baconpaul::six_sines::presets
+{
+/*
+ * Walks the user patch tree on a worker thread about once a second and holds what changed
+ * until the editor takes it, so the editor's idle never touches the disk or waits on the
+ * PresetIndex lock. The thread starts on the first take, so a read-only PresetManager never
+ * has one.
+ */
+struct UserPresetWatcher
+{
+    // A fresh listing if the change log had moved past us, then the changes after it
+    struct Found
+    {
+        std::optional<std::vector<fs::path>> listing;
+        std::vector<PresetIndex::Change> changes;
+    };
+
+    UserPresetWatcher() = default;
+    ~UserPresetWatcher();
+
+    // What turned up since the last take, if anything; never blocks on the walk
+    std::optional<Found> take(const fs::path &root, const fs::path &indexFile, uint64_t seq);
+
+    // Walk now rather than at the next tick
+    void poke();
+
+  private:
+    static constexpr std::chrono::milliseconds pollInterval{1000};
+
+    fs::path root, indexFile;
+    uint64_t seq{0};
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping{false}, poked{false};
+    std::optional<Found> found;
+    std::unique_ptr<std::thread> worker;
+
+    void run();
+};
+} // namespace baconpaul::six_sines::presets
+#endif // PRESET_WATCH_H
@@ -0,0 +1,148 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_SYNTH_LAG_BANK_H
+#define BACONPAUL_SIX_SINES_SYNTH_LAG_BANK_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <sst/basic-blocks/simd/setup.h>
+
+namespace baconpaul::six_sines
+{
+/*
+ * A set of linear lags kept struct-of-arrays so the moving ones advance four at a time,
+ * then get scattered to their destination floats. Each lag is a fixed number of steps
+ * from wherever it was to its new target.
+ *
+ * The caller owns an int slot per destination, -1 when not moving, which is what makes
+ * add and remove O(1): removal swaps the last entry down and fixes up its slot.
+ */
+struct LagBank
+{
+    // main thread, before audio runs
+    void reserve(size_t n)
+    {
+        auto cap = (n + 3) & ~size_t(3);
+        value.assign(cap, 0.f);
+        target.assign(cap, 0.f);
+        dv.assign(cap, 0.f);
+        remaining.assign(cap, 0);
+        dest.assign(cap, nullptr);
+        slotOf.assign(cap, nullptr);
+        count = 0;
+    }
+
+    void setRateInMilliseconds(double ms, double sampleRate, double blockSizeInv)
+    {
+        steps = std::max(1, (int)std::round(ms * 0.001 * sampleRate * blockSizeInv));
+    }
+
+    void setTarget(int &slot, float *onto, float to)
+    {
+        if (slot < 0)
+        {
+            if (count == dest.size())
+            {
+                *onto = to;
+                return;
+            }
+            slot = (int)count++;
+            value[slot] = *onto;
+            dest[slot] = onto;
+            slotOf[slot] = &slot;
+        }
+        target[slot] = to;
+        dv[slot] = (to - value[slot]) / steps;
+        remaining[slot] = steps;
+    }
+
+    void process()
+    {
+        auto one = SIMD_MM(set1_epi32)(1);
+        for (size_t i = 0; i < count; i += 4)
+        {
+            auto r = SIMD_MM(loadu_si128)((SIMD_M128I *)(&remaining[i]));
+            r = SIMD_MM(sub_epi32)(r, one);
+            auto v = SIMD_MM(add_ps)(SIMD_MM(loadu_ps)(&value[i]), SIMD_MM(loadu_ps)(&dv[i]));
+            auto done = SIMD_MM(castsi128_ps)(SIMD_MM(cmplt_epi32)(r, one));
+            v = SIMD_MM(or_ps)(SIMD_MM(and_ps)(done, SIMD_MM(loadu_ps)(&target[i])),
+                               SIMD_MM(andnot_ps)(done, v));
+            SIMD_MM(storeu_ps)(&value[i], v);
+            SIMD_MM(storeu_si128)((SIMD_M128I *)(&remaining[i]), r);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+            *dest[i] = value[i];
+
+        // walk down so the entry swapped into i has already been processed
+        for (size_t i = count; i-- > 0;)
+        {
+            if (remaining[i] <= 0)
+                removeAt(i);
+        }
+    }
+
+    void snapAllToTarget()
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            *dest[i] = target[i];
+            *slotOf[i] = -1;
+        }
+        count = 0;
+    }
+
+    // leave the destinations wherever they are now
+    void stopAll()
+    {
+        for (size_t i = 0; i < count; ++i)
+            *slotOf[i] = -1;
+        count = 0;
+    }
+
+    size_t activeCount() const { return count; }
+    float targetOf(int slot) const { return target[slot]; }
+
+  private:
+    void removeAt(size_t i)
+    {
+        *slotOf[i] = -1;
+        auto last = --count;
+        if (i != last)
+        {
+            value[i] = value[last];
+            target[i] = target[last];
+            dv[i] = dv[last];
+            remaining[i] = remaining[last];
+            dest[i] = dest[last];
+            slotOf[i] = slotOf[last];
+            *slotOf[i] = (int)i;
+        }
+        // keep the padding lanes harmless for the next block
+        dv[last] = 0.f;
+        remaining[last] = 0;
+    }
+
+    int steps{1};
+    size_t count{0};
+    std::vector<float> value, target, dv;
+    std::vector<int32_t> remaining;
+    std::vector<float *> dest;
+    std::vector<int *> slotOf;
+};
+} // namespace baconpaul::six_sines
+#endif // LAG_BANK_H
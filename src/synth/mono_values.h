@@ -19,8 +19,10 @@
 #include <sst/basic-blocks/tables/EqualTuningProvider.h>
 #include <sst/basic-blocks/tables/TwoToTheXProvider.h>
 #include <sst/basic-blocks/dsp/RNG.h>
+#include <sst/basic-blocks/dsp/Lag.h>
 
 #include "mod_matrix.h"
+#include "dsp/fast_exp2.h"
 
 struct MTSClient;
 
@@ -33,7 +35,8 @@ struct SRProvider
     SRProvider(const sst::basic_blocks::tables::TwoToTheXProvider &t) : ttx(t) {}
     float envelope_rate_linear_nowrap(float f) const
     {
-        return (blockSize * sampleRateInv) * ttx.twoToThe(-f);
+        // this is the LFO and envelope rate, once per block per node per voice
+        return (blockSize * sampleRateInv) * fastExp2(-f);
     }
 
     void setSampleRate(double sr)
@@ -41,10 +44,14 @@ struct SRProvider
         samplerate = sr;
         sampleRate = sr;
         sampleRateInv = 1.0 / sr;
+        generation++;
     }
     double samplerate{1};
     double sampleRate{1};
     double sampleRateInv{1};
+
+    // bumped on each rate change so per-rate setup (like envelope luts) can be done lazily
+    uint32_t generation{0};
 };
 
 struct MonoValues
@@ -64,15 +71,30 @@ struct MonoValues
 
     bool attackFloorOnRetrig{true};
 
+    // A voice whose peak stays under the floor (linear, 0 for never) for silentVoiceBlocks
+    // is faded out early
+    float silentVoiceFloor{0.f};
+    int32_t silentVoiceBlocks{1};
+
     std::array<float *, numMacros> macroPtr;
 
     MTSClient *mtsClient{nullptr};
 
+    // MTS-ESP retuning by [channel][key], refreshed for the sounding keys once per
+    // process call by Synth::refreshMTSRetuning so voices just read it
+    bool mtsHasMaster{false};
+    uint32_t mtsBlock{1};
+    std::array<std::array<float, 128>, 16> mtsRetuning{};
+    std::array<std::array<uint32_t, 128>, 16> mtsRetuningBlock{};
+
     sst::basic_blocks::tables::EqualTuningProvider tuningProvider;
     sst::basic_blocks::tables::TwoToTheXProvider twoToTheX;
 
     sst::basic_blocks::dsp::RNG rng;
 
+    // Set up once per sample rate and copied into each voice / stepped LFO at attack
+    sst::basic_blocks::dsp::OnePoleLag<float, false> lfoSmoothLag, velocityLag;
+
     ModMatrixConfig modMatrixConfig;
 
     SRProvider sr;
@@ -13,6 +13,8 @@
  * The source code and license are at https://github.com/baconpaul/six-sines
  */
 
+#include <cassert>
+#include <cstring>
 #include "patch.h"
 namespace baconpaul::six_sines
 {
@@ -133,6 +135,269 @@ float Patch::migrateParamValueFromVersion(Param *p, float value, uint32_t versio
     return value;
 }
 
+void Patch::decodeRenderPlan()
+{
+    for (auto &n : sourceNodes)
+        n.decodePlan();
+    for (auto &n : selfNodes)
+        n.decodePlan();
+    for (auto &n : matrixNodes)
+        n.decodePlan();
+    for (auto &n : mixerNodes)
+    {
+        n.decodeEnvPlan();
+        n.decodeLFOPlan();
+    }
+    output.decodePlan();
+    fineTuneMod.decodeEnvPlan();
+    fineTuneMod.decodeLFOPlan();
+    mainPanMod.decodeEnvPlan();
+    mainPanMod.decodeLFOPlan();
+}
+
+/*
+ * The binary state is written in native byte order, which is little endian on every
+ * platform we ship. Values are read with memcpy since the pairs are not aligned.
+ */
+namespace
+{
+template <typename T> void appendRaw(std::string &to, const T &v)
+{
+    to.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T> bool readRaw(const std::string &from, size_t &pos, T &v)
+{
+    if (pos + sizeof(T) > from.size())
+        return false;
+    memcpy(&v, from.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+} // namespace
+
+bool Patch::isBinaryState(const std::string &data)
+{
+    return data.size() >= sizeof(binaryStateMagic) &&
+           memcmp(data.data(), binaryStateMagic, sizeof(binaryStateMagic)) == 0;
+}
+
+std::string Patch::toBinaryState() const
+{
+    std::vector<float> values;
+    values.reserve(params.size());
+    for (const auto *p : params)
+        values.push_back(p->value);
+    return toBinaryState(values, name);
+}
+
+std::string Patch::toBinaryState(const std::vector<float> &values, const char *stateName) const
+{
+    auto nameLen = (uint32_t)strnlen(stateName, sizeof(name) - 1);
+    auto count = (uint32_t)std::min(params.size(), values.size());
+
+    std::string res;
+    res.reserve(sizeof(binaryStateMagic) + 4 * sizeof(uint32_t) + nameLen +
+                count * (sizeof(uint32_t) + sizeof(float)));
+    res.append(binaryStateMagic, sizeof(binaryStateMagic));
+    appendRaw(res, binaryStateFormat);
+    appendRaw(res, patchVersion);
+    appendRaw(res, nameLen);
+    res.append(stateName, nameLen);
+    appendRaw(res, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        appendRaw(res, (uint32_t)params[i]->meta.id);
+        appendRaw(res, values[i]);
+    }
+    return res;
+}
+
+std::string Patch::binaryStateFromPairs(uint32_t version, const std::string &stateName,
+                                        const std::vector<std::pair<uint32_t, float>> &pairs)
+{
+    auto nameLen = (uint32_t)std::min(stateName.size(), sizeof(name) - 1);
+    uint32_t count{0};
+    for (const auto &[id, v] : pairs)
+        count += std::isnan(v) ? 0 : 1;
+
+    std::string res;
+    res.reserve(sizeof(binaryStateMagic) + 4 * sizeof(uint32_t) + nameLen +
+                count * (sizeof(uint32_t) + sizeof(float)));
+    res.append(binaryStateMagic, sizeof(binaryStateMagic));
+    appendRaw(res, binaryStateFormat);
+    appendRaw(res, version);
+    appendRaw(res, nameLen);
+    res.append(stateName.data(), nameLen);
+    appendRaw(res, count);
+    for (const auto &[id, v] : pairs)
+    {
+        if (std::isnan(v))
+            continue;
+        appendRaw(res, id);
+        appendRaw(res, v);
+    }
+    return res;
+}
+
+bool Patch::fromBinaryState(const std::string &data)
+{
+    if (!isBinaryState(data))
+        return false;
+
+    size_t pos{sizeof(binaryStateMagic)};
+    uint32_t format{0}, version{0}, nameLen{0}, count{0};
+    if (!readRaw(data, pos, format) || format > binaryStateFormat)
+    {
+        SXSNLOG("Binary state format " << format << " is newer than this build reads");
+        return false;
+    }
+    if (!readRaw(data, pos, version) || !readRaw(data, pos, nameLen) ||
+        pos + nameLen > data.size())
+        return false;
+
+    memset(name, 0, sizeof(name));
+    memcpy(name, data.data() + pos, std::min((size_t)nameLen, sizeof(name) - 1));
+    pos += nameLen;
+
+    if (!readRaw(data, pos, count))
+        return false;
+
+    // params missing from an older state keep their default, as in the XML
+    for (auto *p : params)
+        p->value = p->meta.defaultVal;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t pid;
+        float value;
+        if (!readRaw(data, pos, pid) || !readRaw(data, pos, value))
+            return false;
+
+        auto it = paramMap.find(pid);
+        if (it == paramMap.end())
+            continue;
+        if (version < patchVersion)
+            value = migrateParamValueFromVersion(it->second, value, version);
+        it->second->value = value;
+    }
+
+    if (version < patchVersion)
+        migratePatchFromVersion(version);
+
+    return true;
+}
+
+bool Patch::binaryStateToValues(const std::string &data, std::vector<float> &values,
+                                std::string &stateName)
+{
+    if (!isBinaryState(data))
+        return false;
+
+    size_t pos{sizeof(binaryStateMagic)};
+    uint32_t format{0}, version{0}, nameLen{0}, count{0};
+    if (!readRaw(data, pos, format) || format > binaryStateFormat || !readRaw(data, pos, version) ||
+        version != patchVersion || !readRaw(data, pos, nameLen) || pos + nameLen > data.size())
+        return false;
+
+    stateName.assign(data.data() + pos, std::min((size_t)nameLen, sizeof(name) - 1));
+    pos += nameLen;
+
+    if (!readRaw(data, pos, count))
+        return false;
+
+    const auto &table = paramTable();
+    values = table.defaults;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t pid;
+        float value;
+        if (!readRaw(data, pos, pid) || !readRaw(data, pos, value))
+            return false;
+
+        auto it = table.indexOfId.find(pid);
+        if (it != table.indexOfId.end())
+            values[it->second] = value;
+    }
+    return true;
+}
+
+const Patch::ParamTable &Patch::paramTable()
+{
+    static const ParamTable table = []()
+    {
+        Patch proto;
+        ParamTable res;
+        res.ids.reserve(proto.params.size());
+        res.defaults.reserve(proto.params.size());
+        for (const auto *p : proto.params)
+        {
+            res.indexOfId[p->meta.id] = (uint32_t)res.ids.size();
+            res.ids.push_back(p->meta.id);
+            res.defaults.push_back(p->meta.defaultVal);
+        }
+        return res;
+    }();
+    return table;
+}
+
+void Patch::orderParams()
+{
+    // The order only depends on the metadata, so work it out for the first patch and then
+    // every later patch (state loads, preset browsing, editor copies) just applies it
+    static const std::vector<size_t> order = [this]()
+    {
+        std::vector<size_t> res(params.size());
+        for (size_t i = 0; i < res.size(); ++i)
+            res[i] = i;
+
+        std::sort(res.begin(), res.end(),
+                  [this](size_t ia, size_t ib)
+                  {
+                      const auto *a = params[ia];
+                      const auto *b = params[ib];
+                      const auto &ga = a->meta.groupName;
+                      const auto &gb = b->meta.groupName;
+                      if (ga != gb)
+                      {
+                          if (ga == "Main")
+                              return true;
+                          if (gb == "Main")
+                              return false;
+
+                          return ga < gb;
+                      }
+
+                      const auto &an = a->meta.name;
+                      const auto &bn = b->meta.name;
+                      auto ane = an.find("Env ") != std::string::npos;
+                      auto bne = bn.find("Env ") != std::string::npos;
+
+                      if (ane != bne)
+                      {
+                          if (ane)
+                              return false;
+
+                          return true;
+                      }
+                      if (ane && bne)
+                          return a->meta.id < b->meta.id;
+
+                      return an < bn;
+                  });
+        return res;
+    }();
+
+    assert(order.size() == params.size());
+    std::vector<Param *> sorted;
+    sorted.reserve(order.size());
+    for (auto i : order)
+        sorted.push_back(params[i]);
+    params = std::move(sorted);
+    for (uint32_t i = 0; i < params.size(); ++i)
+        params[i]->index = i;
+}
+
 void Patch::migratePatchFromVersion(uint32_t version)
 {
     if (version == 7)
@@ -155,6 +420,12 @@ void Patch::migratePatchFromVersion(uint32_t version)
         fixTrigMod(fineTuneMod);
         fixTrigMod(mainPanMod);
     }
+
+    if (version < 10)
+    {
+        // culling silent voices came in with 10; older patches keep every voice as they did
+        output.silentVoiceFloor.value = 0;
+    }
 }
 
 } // namespace baconpaul::six_sines
\ No newline at end of file
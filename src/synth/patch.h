@@ -18,12 +18,13 @@
 
 #include <vector>
 #include <array>
+#include <string>
 #include <unordered_map>
 #include <algorithm>
+#include <cmath>
 #include <clap/clap.h>
 #include "configuration.h"
 #include "sst/cpputils/constructors.h"
-#include "sst/cpputils/active_set_overlay.h"
 #include "sst/basic-blocks/params/ParamMetadata.h"
 #include "sst/basic-blocks/dsp/Lag.h"
 #include "sst/basic-blocks/modulators/DAHDSREnvelope.h"
@@ -36,7 +37,7 @@ namespace baconpaul::six_sines
 namespace scpu = sst::cpputils;
 namespace pats = sst::plugininfra::patch_support;
 using md_t = sst::basic_blocks::params::ParamMetaData;
-struct Param : pats::ParamBase, sst::cpputils::active_set_overlay<Param>::participant
+struct Param : pats::ParamBase
 {
     Param(const md_t &m) : pats::ParamBase(m) {}
 
@@ -52,7 +53,8 @@ struct Param : pats::ParamBase, sst::cpputils::active_set_overlay<Param>::partic
         ENVTIME = 1 << 0,     // tag for ADSR envs we changed version 2-3
         TRIGGERMODE = 1 << 1, // trigger mode for when we nuked voice
         WAVEFORM = 1 << 2,
-        SOLO = 1 << 3
+        SOLO = 1 << 3,
+        RENDER_PLAN = 1 << 4 // decoded into a node plan, see Patch::decodeRenderPlan
     };
 
     bool isTemposynced() const
@@ -65,12 +67,13 @@ struct Param : pats::ParamBase, sst::cpputils::active_set_overlay<Param>::partic
 
     Param *tempoSyncPartner{nullptr};
 
-    sst::basic_blocks::dsp::LinearLag<float, false> lag;
+    int lagSlot{-1}; // where this param sits in Synth::paramLags while it moves
+    uint32_t index{0}; // where this param sits in Patch::params
 };
 
 struct Patch : pats::PatchBase<Patch, Param>
 {
-    static constexpr uint32_t patchVersion{9};
+    static constexpr uint32_t patchVersion{10};
     static constexpr const char *id{"org.baconpaul.six-sines"};
 
     static constexpr uint32_t floatFlags{CLAP_PARAM_IS_AUTOMATABLE};
@@ -106,38 +109,7 @@ struct Patch : pats::PatchBase<Patch, Param>
         pushParams(fineTuneMod);
         pushParams(mainPanMod);
 
-        std::sort(params.begin(), params.end(),
-                  [](const Param *a, const Param *b)
-                  {
-                      auto ga = a->meta.groupName;
-                      auto gb = b->meta.groupName;
-                      if (ga != gb)
-                      {
-                          if (ga == "Main")
-                              return true;
-                          if (gb == "Main")
-                              return false;
-
-                          return ga < gb;
-                      }
-
-                      auto an = a->meta.name;
-                      auto bn = b->meta.name;
-                      auto ane = an.find("Env ") != std::string::npos;
-                      auto bne = bn.find("Env ") != std::string::npos;
-
-                      if (ane != bne)
-                      {
-                          if (ane)
-                              return false;
-
-                          return true;
-                      }
-                      if (ane && bne)
-                          return a->meta.id < b->meta.id;
-
-                      return a->meta.name < b->meta.name;
-                  });
+        orderParams();
     }
 
     struct LFOMixin
@@ -198,11 +170,27 @@ struct Patch : pats::PatchBase<Patch, Param>
                                 .withLinearScaleFormatting(""))
         {
             lfoRate.tempoSyncPartner = &tempoSync;
+            for (auto *p : {&lfoShape, &tempoSync, &lfoBipolar, &lfoIsEnveloped})
+                p->adhocFeatures |= Param::AdHocFeatureValues::RENDER_PLAN;
         }
 
         Param lfoRate, lfoDeform, lfoShape, lfoActive, tempoSync, lfoBipolar, lfoIsEnveloped,
             lfoStartPhase;
 
+        struct LFOPlan
+        {
+            int shape{0};
+            bool tempoSync{false}, bipolar{true}, isEnveloped{false};
+        } lfoPlan;
+
+        void decodeLFOPlan()
+        {
+            lfoPlan.shape = (int)std::round(lfoShape.value);
+            lfoPlan.tempoSync = tempoSync.value > 0.5;
+            lfoPlan.bipolar = lfoBipolar.value > 0.5;
+            lfoPlan.isEnveloped = lfoIsEnveloped.value > 0.5;
+        }
+
         void appendLFOParams(std::vector<Param *> &res)
         {
             res.push_back(&lfoRate);
@@ -323,12 +311,27 @@ struct Patch : pats::PatchBase<Patch, Param>
             release.adhocFeatures = Param::AdHocFeatureValues::ENVTIME;
 
             triggerMode.adhocFeatures = Param::AdHocFeatureValues::TRIGGERMODE;
+
+            for (auto *p : {&envIsMultiplcative, &envIsOneShot, &envTriggersFromZero})
+                p->adhocFeatures |= Param::AdHocFeatureValues::RENDER_PLAN;
         }
 
         Param delay, attack, hold, decay, sustain, release, envPower;
         Param aShape, dShape, rShape, triggerMode, envIsMultiplcative, envIsOneShot,
             envTriggersFromZero;
 
+        struct EnvPlan
+        {
+            bool isMult{true}, isOneShot{false}, triggersFromZero{false};
+        } envPlan;
+
+        void decodeEnvPlan()
+        {
+            envPlan.isMult = envIsMultiplcative.value > 0.5;
+            envPlan.isOneShot = envIsOneShot.value > 0.5;
+            envPlan.triggersFromZero = envTriggersFromZero.value > 0.5;
+        }
+
         void appendDAHDSRParams(std::vector<Param *> &res)
         {
             res.push_back(&delay);
@@ -583,6 +586,16 @@ struct Patch : pats::PatchBase<Patch, Param>
                                 .withUnorderedMapFormatting({{0, "All to Op Output"},
                                                              {1, "Center to Op Output"},
                                                              {2, "Sides to Op Output"}})),
+              interpolation(intMd()
+                                .withRange(0, SinTable::Interpolation::NUM_INTERPOLATIONS - 1)
+                                .withDefault(SinTable::Interpolation::CUBIC_HERMITE)
+                                .withID(id(19, idx))
+                                .withName(name(idx) + " Interpolation")
+                                .withGroupName(name(idx))
+                                .withUnorderedMapFormatting(
+                                    {{SinTable::Interpolation::CUBIC_HERMITE, "Cubic"},
+                                     {SinTable::Interpolation::LINEAR, "Linear"},
+                                     {SinTable::Interpolation::TRUNCATE, "Truncate"}})),
 
               DAHDSRMixin(name(idx), id(100, idx), false), LFOMixin(name(idx), id(45, idx)),
               ModulationMixin(name(idx), id(150, idx)),
@@ -600,6 +613,9 @@ struct Patch : pats::PatchBase<Patch, Param>
         {
             index = idx;
             waveForm.adhocFeatures = Param::AdHocFeatureValues::WAVEFORM;
+            for (auto *p : {&waveForm, &keyTrack, &keyTrackValueIsLow, &octTranspose,
+                            &unisonParticipation, &unisonToMain, &unisonToOpOut, &interpolation})
+                p->adhocFeatures |= Param::AdHocFeatureValues::RENDER_PLAN;
             appendLFOTargetName(targetList);
             appendDAHDSRTargetName(targetList);
         }
@@ -629,8 +645,48 @@ struct Patch : pats::PatchBase<Patch, Param>
 
         Param unisonParticipation, unisonToMain, unisonToOpOut;
 
+        Param interpolation;
+
         std::array<Param, numModsPer> modtarget;
 
+        // the discrete params above decoded once per change rather than per voice and block
+        struct Plan
+        {
+            SinTable::WaveForm waveForm{SinTable::SIN};
+            SinTable::Interpolation interpolation{SinTable::CUBIC_HERMITE};
+            bool keyTrack{true}, keyTrackValueIsLow{false};
+            float octaveFactor{1.f};
+            bool unisonParticipatesTune{true}, unisonParticipatesPan{true};
+            int unisonToMain{0}, unisonToOpOut{0};
+
+            // what a voice would otherwise work out from the above on every attack
+            bool polySin{false}, dcBlocksOutput{false};
+        } plan;
+
+        void decodePlan()
+        {
+            plan.waveForm = (SinTable::WaveForm)std::round(waveForm.value);
+            plan.interpolation = (SinTable::Interpolation)std::clamp(
+                (int)std::round(interpolation.value), 0, (int)SinTable::NUM_INTERPOLATIONS - 1);
+            plan.keyTrack = keyTrack.value > 0.5;
+            plan.keyTrackValueIsLow = keyTrackValueIsLow.value > 0.5;
+            plan.octaveFactor =
+                std::ldexp(1.f, std::clamp((int)std::round(octTranspose.value), -3, 3));
+            plan.unisonParticipatesTune = (int)(unisonParticipation.value) & 1;
+            plan.unisonParticipatesPan = (int)(unisonParticipation.value) & 2;
+            plan.unisonToMain = (int)(unisonToMain.value);
+            plan.unisonToOpOut = (int)(unisonToOpOut.value);
+
+            auto wf = plan.waveForm;
+            plan.polySin = SinTable::usePolynomialSin && wf == SinTable::SIN &&
+                           plan.interpolation == SinTable::CUBIC_HERMITE;
+            plan.dcBlocksOutput = wf == SinTable::TX3 || wf == SinTable::TX4 ||
+                                  wf == SinTable::TX7 || wf == SinTable::TX8 ||
+                                  wf == SinTable::SPIKY_TX4 || wf == SinTable::SPIKY_TX8;
+            decodeEnvPlan();
+            decodeLFOPlan();
+        }
+
         std::vector<Param *> params()
         {
             std::vector<Param *> res{&ratio,
@@ -648,7 +704,8 @@ struct Patch : pats::PatchBase<Patch, Param>
                                      &lfoToRatioFine,
                                      &unisonParticipation,
                                      &unisonToMain,
-                                     &unisonToOpOut};
+                                     &unisonToOpOut,
+                                     &interpolation};
             for (int i = 0; i < numModsPer; ++i)
                 res.push_back(&modtarget[i]);
             appendDAHDSRParams(res);
@@ -721,6 +778,7 @@ struct Patch : pats::PatchBase<Patch, Param>
                   }))
         {
             index = idx;
+            overdrive.adhocFeatures |= Param::AdHocFeatureValues::RENDER_PLAN;
             appendLFOTargetName(targetList);
             appendDAHDSRTargetName(targetList);
         }
@@ -741,6 +799,18 @@ struct Patch : pats::PatchBase<Patch, Param>
 
         std::array<Param, numModsPer> modtarget;
 
+        struct Plan
+        {
+            float overdriveFactor{1.f};
+        } plan;
+
+        void decodePlan()
+        {
+            plan.overdriveFactor = overdrive.value > 0.5 ? 10.f : 1.f;
+            decodeEnvPlan();
+            decodeLFOPlan();
+        }
+
         std::vector<Param *> params()
         {
             std::vector<Param *> res{&fbLevel, &active, &lfoToFB, &envToFB, &overdrive};
@@ -841,6 +911,8 @@ struct Patch : pats::PatchBase<Patch, Param>
 
         {
             index = idx;
+            for (auto *p : {&modulationMode, &modulationScale, &overdrive})
+                p->adhocFeatures |= Param::AdHocFeatureValues::RENDER_PLAN;
             appendLFOTargetName(targetList);
             appendDAHDSRTargetName(targetList);
         }
@@ -854,6 +926,22 @@ struct Patch : pats::PatchBase<Patch, Param>
 
         std::array<Param, numModsPer> modtarget;
 
+        struct Plan
+        {
+            int modMode{0}, rmScale{0};
+            float overdriveFactor{1.f};
+        } plan;
+
+        void decodePlan()
+        {
+            plan.modMode = (int)std::round(modulationMode.value);
+            plan.rmScale = (int)std::round(modulationScale.value);
+            // mode 3 is exponential FM which gets a gentler overdrive
+            plan.overdriveFactor = overdrive.value > 0.5 ? (plan.modMode == 3 ? 3.f : 10.f) : 1.f;
+            decodeEnvPlan();
+            decodeLFOPlan();
+        }
+
         // Use *this* version in constructor
         std::string name(int idx) const
         {
@@ -1236,7 +1324,7 @@ struct Patch : pats::PatchBase<Patch, Param>
                             .withRange(1, maxVoices)
                             .withName(name() + " PolyLimit")
                             .withGroupName(name())
-                            .withDefault(maxVoices)
+                            .withDefault(defaultVoiceLimit)
                             .withID(id(26))
                             .withLinearScaleFormatting("")),
               defaultTrigger(
@@ -1368,6 +1456,16 @@ struct Patch : pats::PatchBase<Patch, Param>
                             .withDefault(0.8)
                             .withGroupName(name())
                             .withID(id(42))),
+              silentVoiceFloor(intMd()
+                                   .withName(name() + " Silent Voice Floor")
+                                   .withGroupName(name())
+                                   .withRange(0, 3)
+                                   .withDefault(2)
+                                   .withID(id(44))
+                                   .withUnorderedMapFormatting({{0, "Never Cull"},
+                                                                {1, "Cull < -96dB"},
+                                                                {2, "Cull < -120dB"},
+                                                                {3, "Cull < -144dB"}})),
               ModulationMixin(name(), id(120)),
               modtarget(scpu::make_array_lambda<Param, numModsPer>(
                   [this](int i)
@@ -1387,6 +1485,8 @@ struct Patch : pats::PatchBase<Patch, Param>
                                                       .withID(id(220)))
         {
             defaultTrigger.adhocFeatures = Param::AdHocFeatureValues::TRIGGERMODE;
+            for (auto *p : {&octTranspose, &defaultTrigger})
+                p->adhocFeatures |= Param::AdHocFeatureValues::RENDER_PLAN;
             appendLFOTargetName(targetList);
             appendDAHDSRTargetName(targetList);
         }
@@ -1402,9 +1502,25 @@ struct Patch : pats::PatchBase<Patch, Param>
         Param octTranspose, fineTune, pan, lfoDepth;
         Param attackFloorOnRetrig, rephaseOnRetrigger;
         Param sampleRateStrategy, resampleEngine;
+        Param silentVoiceFloor;
 
         std::array<Param, numModsPer> modtarget;
 
+        struct Plan
+        {
+            float octaveFactor{1.f};
+            int defaultTrigger{0};
+        } plan;
+
+        void decodePlan()
+        {
+            plan.defaultTrigger = (int)std::round(defaultTrigger.value);
+            plan.octaveFactor =
+                std::ldexp(1.f, std::clamp((int)std::round(octTranspose.value), -3, 3));
+            decodeEnvPlan();
+            decodeLFOPlan();
+        }
+
         std::vector<Param *> params()
         {
             std::vector<Param *> res{&level,
@@ -1430,7 +1546,8 @@ struct Patch : pats::PatchBase<Patch, Param>
                                      &attackFloorOnRetrig,
                                      &rephaseOnRetrigger,
                                      &sampleRateStrategy,
-                                     &resampleEngine};
+                                     &resampleEngine,
+                                     &silentVoiceFloor};
             appendDAHDSRParams(res);
 
             for (int i = 0; i < numModsPer; ++i)
@@ -1456,6 +1573,46 @@ struct Patch : pats::PatchBase<Patch, Param>
 
     float migrateParamValueFromVersion(Param *p, float value, uint32_t version);
     void migratePatchFromVersion(uint32_t version);
+
+    /*
+     * Compact state for host sessions: a header (magic, format, patchVersion, name) then
+     * packed (id, value) pairs. Presets stay XML through toState / fromState. Loading an
+     * older patchVersion migrates just like the XML does.
+     */
+    static constexpr char binaryStateMagic[4]{'S', 'X', 'S', 'B'};
+    static constexpr uint32_t binaryStateFormat{1};
+    static bool isBinaryState(const std::string &data);
+    std::string toBinaryState() const;
+    // the same from values held elsewhere, in params order
+    std::string toBinaryState(const std::vector<float> &values, const char *stateName) const;
+    bool fromBinaryState(const std::string &data);
+    // the same from (id, value) pairs, such as a factory bank entry; NaN values are skipped
+    static std::string binaryStateFromPairs(uint32_t version, const std::string &stateName,
+                                            const std::vector<std::pair<uint32_t, float>> &pairs);
+
+    // audio thread; rebuilds every node's plan from the RENDER_PLAN params
+    void decodeRenderPlan();
+
+    /*
+     * What every patch shares about its param table: the params order, and each id's
+     * index in it. Built once from a prototype so code which only moves values around
+     * doesn't have to construct a Patch.
+     */
+    struct ParamTable
+    {
+        std::vector<uint32_t> ids;
+        std::unordered_map<uint32_t, uint32_t> indexOfId;
+        std::vector<float> defaults;
+    };
+    static const ParamTable &paramTable();
+
+    // Decode a current version binary state straight to values in params order. Older
+    // versions need migrating through a Patch so return false for those.
+    static bool binaryStateToValues(const std::string &data, std::vector<float> &values,
+                                    std::string &stateName);
+
+  private:
+    void orderParams();
 };
 } // namespace baconpaul::six_sines
 #endif // PATCH_H
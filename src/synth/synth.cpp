@@ -13,6 +13,8 @@
  * The source code and license are at https://github.com/baconpaul/six-sines
  */
 
+#include <thread>
+
 #include "synth/synth.h"
 #include "sst/cpputils/constructors.h"
 #include "sst/basic-blocks/mechanics/block-ops.h"
@@ -29,8 +31,7 @@ namespace mech = sst::basic_blocks::mechanics;
 namespace sdsp = sst::basic_blocks::dsp;
 
 Synth::Synth(bool mo)
-    : isMultiOut(mo), responder(*this), monoResponder(*this),
-      voices(sst::cpputils::make_array<Voice, VMConfig::maxVoiceCount>(patch, monoValues))
+    : isMultiOut(mo), responder(*this), monoResponder(*this)
 {
     voiceManager = std::make_unique<voiceManager_t>(responder, monoResponder);
     monoValues.mtsClient = MTS_RegisterClient();
@@ -43,8 +44,26 @@ Synth::Synth(bool mo)
     std::fill(lState.begin(), lState.end(), nullptr);
     std::fill(rState.begin(), rState.end(), nullptr);
 
+    paramLags.reserve(patch.params.size());
+    midiCCLags.reserve(midiCCLagSlots.size());
+    std::fill(midiCCLagSlots.begin(), midiCCLagSlots.end(), -1);
+
     reapplyControlSettings();
     resetSoloState();
+    patch.decodeRenderPlan();
+
+    monoModVoice = std::make_unique<Voice>(patch, monoValues, voiceSeeds.unifU32());
+    monoModVoice->bindAsMonoModulationVoice();
+    monoModVoice->calculateMonoModulation();
+
+    // No audio thread yet so we can fill the pool directly
+    resizeVoicePool();
+    voicePoolSize = voicePoolFilled;
+    applyVoiceLimit();
+
+    stateValues = std::make_unique<std::atomic<float>[]>(patch.params.size());
+    publishState();
+    uiParams.resize(patch.params.size());
 
     /*
      * Internal consistency checks
@@ -82,6 +101,14 @@ Synth::~Synth()
     for (auto rs : rState)
         if (rs)
             src_delete(rs);
+
+    auto uiM = mainToAudio.pop();
+    while (uiM.has_value())
+    {
+        delete uiM->snapshot;
+        uiM = mainToAudio.pop();
+    }
+    reclaimPatchSnapshots();
 }
 
 void Synth::setSampleRate(double sampleRate)
@@ -132,6 +159,10 @@ void Synth::setSampleRate(double sampleRate)
     engineSampleRate = internalRate;
 
     monoValues.sr.setSampleRate(internalRate);
+    monoValues.lfoSmoothLag.setRateInMilliseconds(10, internalRate, 1.0);
+    monoValues.lfoSmoothLag.snapTo(0.f);
+    monoValues.velocityLag.setRateInMilliseconds(10, internalRate, 1.0 / blockSize);
+    monoValues.silentVoiceBlocks = (int32_t)(0.25 * internalRate / blockSize);
 
     lagHandler.setRate(60, blockSize, monoValues.sr.sampleRate);
     vuPeak.setSampleRate(monoValues.sr.sampleRate);
@@ -174,17 +205,12 @@ void Synth::setSampleRate(double sampleRate)
         }
     }
 
-    for (auto &[i, p] : patch.paramMap)
-    {
-        p->lag.setRateInMilliseconds(1000.0 * 64.0 / 48000.0, engineSampleRate, 1.0 / blockSize);
-        p->lag.snapTo(p->value);
-    }
-    paramLagSet.removeAll();
+    paramLags.setRateInMilliseconds(1000.0 * 64.0 / 48000.0, engineSampleRate, 1.0 / blockSize);
+    paramLags.stopAll();
 
     // midi is a bit less frequent than param automation so a slightly slower smooth
-    midiCCLagCollection.setRateInMilliseconds(1000.0 * 128.0 / 48000.0, engineSampleRate,
-                                              1.0 / blockSize);
-    midiCCLagCollection.snapAllActiveToTarget();
+    midiCCLags.setRateInMilliseconds(1000.0 * 128.0 / 48000.0, engineSampleRate, 1.0 / blockSize);
+    midiCCLags.snapAllToTarget();
 
     audioToUi.push(
         {AudioToUIMsg::SEND_SAMPLE_RATE, 0, (float)hostSampleRate, (float)engineSampleRate});
@@ -203,23 +229,32 @@ template <bool multiOut> void Synth::processInternal(const clap_output_events_t
         return;
     }
 
-    for (auto it = paramLagSet.begin(); it != paramLagSet.end();)
-    {
-        it->lag.process();
-        it->value = it->lag.v;
-        if (!it->lag.isActive())
-        {
-            it = paramLagSet.erase(it);
-        }
-        else
-        {
-            ++it;
-        }
-    }
+    if (voicePoolSize != voicePoolTarget.load(std::memory_order_relaxed))
+        updateVoicePool();
+
+    refreshMTSRetuning();
 
-    midiCCLagCollection.processAll();
+    paramLags.process();
+    midiCCLags.process();
+
+    decodeRenderPlanIfDirty();
 
     monoValues.attackFloorOnRetrig = patch.output.attackFloorOnRetrig > 0.5;
+    switch ((int)std::round(patch.output.silentVoiceFloor.value))
+    {
+    case 1:
+        monoValues.silentVoiceFloor = 1.5849e-5f; // -96 dB
+        break;
+    case 2:
+        monoValues.silentVoiceFloor = 1e-6f; // -120 dB
+        break;
+    case 3:
+        monoValues.silentVoiceFloor = 6.3096e-8f; // -144 dB
+        break;
+    default:
+        monoValues.silentVoiceFloor = 0.f;
+        break;
+    }
 
     int loops{0};
 
@@ -241,6 +276,8 @@ template <bool multiOut> void Synth::processInternal(const clap_output_events_t
         loops++;
         lagHandler.process();
 
+        monoModVoice->calculateMonoModulation();
+
         if (portaContinuation.updateEveryBlock && portaContinuation.active)
         {
             portaContinuation.portaFrac += portaContinuation.dPortaFrac;
@@ -448,6 +485,27 @@ void Synth::process(const clap_output_events_t *o)
         processInternal<false>(o);
 }
 
+void Synth::refreshMTSRetuning()
+{
+    auto &mv = monoValues;
+    mv.mtsHasMaster = mv.mtsClient && MTS_HasMaster(mv.mtsClient);
+    if (!mv.mtsHasMaster)
+        return;
+
+    // unison voices share a key so only ask the master once per key and channel
+    mv.mtsBlock++;
+    for (auto v = head; v; v = v->next)
+    {
+        auto k = v->voiceValues.key & 127;
+        auto c = v->voiceValues.channel & 15;
+        if (mv.mtsRetuningBlock[c][k] != mv.mtsBlock)
+        {
+            mv.mtsRetuning[c][k] = MTS_RetuningInSemitones(mv.mtsClient, k, c);
+            mv.mtsRetuningBlock[c][k] = mv.mtsBlock;
+        }
+    }
+}
+
 void Synth::addToVoiceList(Voice *v)
 {
     v->prior = nullptr;
@@ -520,9 +578,15 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
         doFullRefresh = false;
         didRefresh = true;
     }
+
+    // marked before the pop, so stateSave never sees an empty queue and a fresh copy while
+    // a message is still on its way in
+    if (!mainToAudio.empty())
+        stateStale = true;
     auto uiM = mainToAudio.pop();
     while (uiM.has_value())
     {
+        stateStale = true;
         switch (uiM->action)
         {
         case MainToAudioMsg::REQUEST_REFRESH:
@@ -567,7 +631,8 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
 
                 p.value = uiM->value;
 
-                outq->try_push(outq, &p.header);
+                if (outq)
+                    outq->try_push(outq, &p.header);
             }
             else
             {
@@ -579,6 +644,7 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
              */
             if (dest->meta.id == patch.output.playMode.meta.id ||
                 dest->meta.id == patch.output.polyLimit.meta.id ||
+                dest->meta.id == patch.output.unisonCount.meta.id ||
                 dest->meta.id == patch.output.pianoModeActive.meta.id ||
                 dest->meta.id == patch.output.mpeActive.meta.id ||
                 dest->meta.id == patch.output.sampleRateStrategy.meta.id ||
@@ -592,6 +658,11 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
                 resetSoloState();
             }
 
+            if (dest->adhocFeatures & Param::AdHocFeatureValues::RENDER_PLAN)
+            {
+                renderPlanDirty = true;
+            }
+
             auto d = patch.dirty;
             if (!d)
             {
@@ -621,7 +692,8 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
             p.header.flags = 0;
             p.param_id = uiM->paramId;
 
-            outq->try_push(outq, &p.header);
+            if (outq)
+                outq->try_push(outq, &p.header);
         }
         break;
         case MainToAudioMsg::STOP_AUDIO:
@@ -655,11 +727,6 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
             postLoad();
         }
         break;
-        case MainToAudioMsg::SEND_PREP_FOR_STREAM:
-        {
-            prepForStream();
-        }
-        break;
         case MainToAudioMsg::SEND_REQUEST_RESCAN:
         {
             onMainRescanParams = true;
@@ -677,9 +744,143 @@ void Synth::processUIQueue(const clap_output_events_t *outq)
             voiceManager->allSoundsOff();
         }
         break;
+        case MainToAudioMsg::APPLY_PATCH_SNAPSHOT:
+        {
+            applyPatchSnapshot(uiM->snapshot);
+        }
+        break;
         }
         uiM = mainToAudio.pop();
     }
+
+    publishStateIfStale();
+}
+
+void Synth::publishStateIfStale()
+{
+    blocksSinceStatePublish++;
+
+    // a save is waiting; publish now, once everything sent before it has been handled
+    if (statePublishRequested && mainToAudio.empty())
+    {
+        if (lagHandler.active)
+            lagHandler.instantlySnap();
+        publishState();
+        stateStale = false;
+        statePublishRequested = false;
+        return;
+    }
+
+    if (!stateStale)
+        return;
+
+    // mid-drag values are only worth saving if the drag goes on for a while
+    auto settled = !lagHandler.active;
+    if (!settled && blocksSinceStatePublish < statePublishInterval)
+        return;
+
+    publishState();
+    stateStale = !settled;
+}
+
+bool Synth::publishedStateIsBehind() const
+{
+    // the queue first; processUIQueue marks stale before it pops
+    return !mainToAudio.empty() || stateStale;
+}
+
+bool Synth::publishPendingStateWhileInactive()
+{
+    if (!publishedStateIsBehind())
+        return false;
+
+    // what a main thread params flush would do, with no host to tell about edits
+    processUIQueue(nullptr);
+    if (lagHandler.active)
+        lagHandler.instantlySnap();
+    publishState();
+    stateStale = false;
+    return true;
+}
+
+void Synth::publishState()
+{
+    auto seq = stateSeq.load(std::memory_order_relaxed);
+    stateSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < patch.params.size(); ++i)
+    {
+        auto *p = patch.params[i];
+        auto v = p->lagSlot >= 0 ? paramLags.targetOf(p->lagSlot) : p->value;
+        stateValues[i].store(v, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < stateName.size(); ++i)
+        stateName[i].store(patch.name[i], std::memory_order_relaxed);
+
+    stateSeq.store(seq + 2, std::memory_order_release);
+    blocksSinceStatePublish = 0;
+}
+
+void Synth::readPublishedState(std::vector<float> &values, std::string &name) const
+{
+    values.resize(patch.params.size());
+    char nm[sizeof(Patch::name)];
+    while (true)
+    {
+        auto seq = stateSeq.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = stateValues[i].load(std::memory_order_relaxed);
+        for (size_t i = 0; i < stateName.size(); ++i)
+            nm[i] = stateName[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (stateSeq.load(std::memory_order_relaxed) == seq)
+            break;
+    }
+    nm[sizeof(nm) - 1] = 0;
+    name = nm;
+}
+
+void Synth::applyPatchSnapshot(PatchSnapshot *snap)
+{
+    if (!snap)
+        return;
+
+    // anything still sliding would land on top of the new values
+    if (lagHandler.active)
+        lagHandler.instantlySnap();
+    paramLags.stopAll();
+
+    auto n = std::min(snap->values.size(), patch.params.size());
+    for (size_t i = 0; i < n; ++i)
+        patch.params[i]->value = snap->values[i];
+
+    // a Treiber push; the CAS only retries if onMainThread took the list meanwhile, so the
+    // snapshot always lands on it
+    snap->next = retiredSnapshots.load(std::memory_order_relaxed);
+    while (!retiredSnapshots.compare_exchange_weak(snap->next, snap, std::memory_order_release,
+                                                   std::memory_order_relaxed))
+        ;
+    if (clapHost)
+        clapHost->request_callback(clapHost);
+}
+
+void Synth::reclaimPatchSnapshots()
+{
+    auto s = retiredSnapshots.exchange(nullptr, std::memory_order_acquire);
+    while (s)
+    {
+        auto n = s->next;
+        delete s;
+        s = n;
+    }
 }
 
 void Synth::reapplyControlSettings()
@@ -719,7 +920,15 @@ void Synth::reapplyControlSettings()
 
     auto lim = (int)std::round(patch.output.polyLimit.value);
     lim = std::clamp(lim, 1, (int)maxVoices);
-    voiceManager->setPolyphonyGroupVoiceLimit(0, lim);
+    voiceLimit = lim;
+    applyVoiceLimit();
+
+    // The limit already counts unison voices, but a stolen note keeps its voices for a few
+    // blocks while they fade, so leave room for a couple of notes worth on top
+    auto uni = std::clamp((int)std::round(patch.output.unisonCount.value), 1, 5);
+    auto poolTarget = std::min(lim + 2 * uni, (int)maxVoices);
+    if (voicePoolTarget.exchange(poolTarget) != poolTarget && clapHost)
+        clapHost->request_callback(clapHost);
 
     auto mpe = (bool)std::round(patch.output.mpeActive.value);
     if (mpe)
@@ -739,21 +948,24 @@ void Synth::handleParamValue(Param *p, uint32_t pid, float value)
         p = patch.paramMap.at(pid);
     }
 
-    // p->value = value;
-    p->lag.setTarget(value);
-    paramLagSet.addToActive(p);
-
-    AudioToUIMsg au = {AudioToUIMsg::UPDATE_PARAM, pid, value};
-    audioToUi.push(au);
+    if (p->adhocFeatures & Param::AdHocFeatureValues::RENDER_PLAN)
+    {
+        // these are discrete so sweeping through the values between is no use
+        p->value = value;
+        renderPlanDirty = true;
+    }
+    else
+    {
+        paramLags.setTarget(p->lagSlot, &p->value, value);
+    }
+    stateStale = true;
+    uiParams.set(p->index, value);
 }
 
 void Synth::pushFullUIRefresh()
 {
     for (const auto *p : patch.params)
-    {
-        AudioToUIMsg au = {AudioToUIMsg::UPDATE_PARAM, p->meta.id, p->value};
-        audioToUi.push(au);
-    }
+        uiParams.set(p->index, p->value);
     audioToUi.push({AudioToUIMsg::SET_PATCH_NAME, 0, 0, 0, patch.name});
     audioToUi.push({AudioToUIMsg::SET_PATCH_DIRTY_STATE, patch.dirty});
     audioToUi.push(
@@ -774,8 +986,71 @@ void Synth::resetSoloState()
     }
 }
 
+void Synth::updateVoicePool()
+{
+    auto target = voicePoolTarget.load(std::memory_order_relaxed);
+    // until the main thread has freed the last release we can't trust the published count
+    if (voicePoolReleasedTo.load(std::memory_order_acquire) >= 0)
+        return;
+
+    if (target > voicePoolSize)
+    {
+        auto was = voicePoolSize;
+        voicePoolSize = std::min(target, voicePoolPublished.load(std::memory_order_acquire));
+        if (voicePoolSize != was)
+            applyVoiceLimit();
+    }
+    else if (target < voicePoolSize)
+    {
+        // we stopped allocating above target in initializeMultipleVoices so just wait
+        // for those voices to finish before handing them back
+        for (int i = target; i < voicePoolSize; ++i)
+        {
+            if (voices[i]->used)
+                return;
+        }
+        voicePoolSize = target;
+        voicePoolReleasedTo.store(target, std::memory_order_release);
+        if (clapHost)
+            clapHost->request_callback(clapHost);
+    }
+}
+
+void Synth::applyVoiceLimit()
+{
+    voiceManager->setPolyphonyGroupVoiceLimit(0, std::max(1, std::min(voiceLimit, voicePoolSize)));
+}
+
+void Synth::resizeVoicePool()
+{
+    auto rel = voicePoolReleasedTo.load(std::memory_order_acquire);
+    if (rel >= 0)
+    {
+        for (int i = rel; i < voicePoolFilled; ++i)
+            voices[i].reset();
+        voicePoolFilled = std::min(voicePoolFilled, rel);
+        voicePoolPublished.store(voicePoolFilled, std::memory_order_release);
+        voicePoolReleasedTo.store(-1, std::memory_order_release);
+    }
+
+    auto target = voicePoolTarget.load(std::memory_order_acquire);
+    if (target > voicePoolFilled)
+    {
+        for (int i = voicePoolFilled; i < target; ++i)
+        {
+            voices[i] = std::make_unique<Voice>(patch, monoValues, voiceSeeds.unifU32());
+            voices[i]->useMonoModulationFrom(*monoModVoice);
+        }
+        voicePoolFilled = target;
+        voicePoolPublished.store(voicePoolFilled, std::memory_order_release);
+    }
+}
+
 void Synth::onMainThread()
 {
+    resizeVoicePool();
+    reclaimPatchSnapshots();
+
     bool ex{true}, re{false};
     if (onMainRescanParams.compare_exchange_strong(ex, re))
     {
@@ -37,7 +37,8 @@
 #include "synth/patch.h"
 #include "mono_values.h"
 #include "mod_matrix.h"
-#include "sst/basic-blocks/dsp/LagCollection.h"
+#include "synth/lag_bank.h"
+#include "synth/ui_param_mirror.h"
 
 namespace baconpaul::six_sines
 {
@@ -62,7 +63,8 @@ struct Synth
 
     Patch patch;
     MonoValues monoValues;
-    sst::basic_blocks::dsp::LagCollection<130> midiCCLagCollection; // 130 for 128 + pitch + chanat
+    LagBank midiCCLags;
+    std::array<int, 130> midiCCLagSlots; // 130 for 128 + pitch + chanat
 
     struct VMConfig
     {
@@ -70,7 +72,32 @@ struct Synth
         using voice_t = Voice;
     };
 
-    std::array<Voice, VMConfig::maxVoiceCount> voices;
+    /*
+     * The voice pool is sized from the voice limit and unison count rather than always
+     * holding maxVoices. The audio thread picks a size in reapplyControlSettings, the main
+     * thread allocates or frees voices in onMainThread, and the atomics hand them across so
+     * the audio thread only ever touches voices[0..voicePoolSize).
+     */
+    std::array<std::unique_ptr<Voice>, VMConfig::maxVoiceCount> voices;
+    int voicePoolSize{0};                     // audio thread
+    int voicePoolFilled{0};                   // main thread
+    std::atomic<int> voicePoolTarget{0};      // audio -> main
+    std::atomic<int> voicePoolPublished{0};   // main -> audio, filled and safe to use
+    std::atomic<int> voicePoolReleasedTo{-1}; // audio -> main, voices above this are free
+    void updateVoicePool();                   // audio thread
+    void resizeVoicePool();                   // main thread
+    sst::basic_blocks::dsp::RNG voiceSeeds;   // main thread, one seed per voice built
+
+    // The polyLimit setting, handed to the voice manager no higher than the pool so a note
+    // is stolen for rather than dropped while the main thread grows it
+    int voiceLimit{1}; // audio thread
+    void applyVoiceLimit();
+
+    // Not a playing voice; its nodes compute the modulation from mono sources once a block
+    std::unique_ptr<Voice> monoModVoice;
+
+    void refreshMTSRetuning();
+
     Voice *head{nullptr};
     void addToVoiceList(Voice *);
     Voice *removeFromVoiceList(Voice *); // returns next
@@ -121,6 +148,9 @@ struct Synth
             typename sst::voicemanager::VoiceBeginBufferEntry<VMConfig>::buffer_t &buffer, uint16_t,
             uint16_t, uint16_t, int32_t, float)
         {
+            // a plan change in the same event batch as this note has to reach its attack
+            synth.decodeRenderPlanIfDirty();
+
             auto vc = (int)std::round(synth.patch.output.unisonCount.value);
             for (int i = 0; i < vc; ++i)
                 buffer[i].polyphonyGroup = 0;
@@ -175,39 +205,41 @@ struct Synth
                     sst::voicemanager::VoiceInitInstructionsEntry<
                         baconpaul::six_sines::Synth::VMConfig>::Instruction::SKIP)
                 {
-                    for (int i = lastStart; i < VMConfig::maxVoiceCount; ++i)
+                    auto poolEnd = std::min(synth.voicePoolSize, synth.voicePoolTarget.load());
+                    for (int i = lastStart; i < poolEnd; ++i)
                     {
-                        if (synth.voices[i].used == false)
+                        auto &v = *synth.voices[i];
+                        if (v.used == false)
                         {
-                            obuf[vc].voice = &synth.voices[i];
-                            synth.voices[i].used = true;
-                            synth.voices[i].voiceValues.setGated(true);
-                            synth.voices[i].voiceValues.setKey(key);
-                            synth.voices[i].voiceValues.channel = ch;
-                            synth.voices[i].voiceValues.velocity = vel;
-                            synth.voices[i].voiceValues.releaseVelocity = 0;
-                            synth.voices[i].voiceValues.uniCount = ct;
-                            synth.voices[i].voiceValues.uniIndex = vc;
-                            synth.voices[i].voiceValues.hasCenterVoice = (ct > 1 && (ct % 2 == 1));
-                            synth.voices[i].voiceValues.isCenterVoice =
+                            obuf[vc].voice = &v;
+                            v.used = true;
+                            v.voiceValues.setGated(true);
+                            v.voiceValues.setKey(key);
+                            v.voiceValues.channel = ch;
+                            v.voiceValues.velocity = vel;
+                            v.voiceValues.releaseVelocity = 0;
+                            v.voiceValues.uniCount = ct;
+                            v.voiceValues.uniIndex = vc;
+                            v.voiceValues.hasCenterVoice = (ct > 1 && (ct % 2 == 1));
+                            v.voiceValues.isCenterVoice =
                                 (ct > 1 && (ct % 2 == 1)) && (std::fabs(uniScale[vc]) < 1e-4);
-                            synth.voices[i].voiceValues.uniRatioMul = uniVal[vc];
-                            synth.voices[i].voiceValues.uniPanShift = uniPan[vc];
-                            synth.voices[i].voiceValues.uniPMScale = uniScale[vc];
-                            synth.voices[i].voiceValues.phaseRandom = (vc > 0 && upr);
-                            synth.voices[i].voiceValues.rephaseOnRetrigger = (!upr && prt);
-                            synth.voices[i].voiceValues.noteExpressionTuningInSemis = 0;
-                            synth.voices[i].voiceValues.noteExpressionPanBipolar = 0;
+                            v.voiceValues.uniRatioMul = uniVal[vc];
+                            v.voiceValues.uniPanShift = uniPan[vc];
+                            v.voiceValues.uniPMScale = uniScale[vc];
+                            v.voiceValues.phaseRandom = (vc > 0 && upr);
+                            v.voiceValues.rephaseOnRetrigger = (!upr && prt);
+                            v.voiceValues.noteExpressionTuningInSemis = 0;
+                            v.voiceValues.noteExpressionPanBipolar = 0;
 
                             if (synth.portaContinuation.active)
                             {
-                                synth.voices[i].restartPortaTo(synth.portaContinuation.sourceKey,
-                                                               key, synth.patch.output.portaTime,
-                                                               synth.portaContinuation.portaFrac);
+                                v.restartPortaTo(synth.portaContinuation.sourceKey, key,
+                                                 synth.patch.output.portaTime,
+                                                 synth.portaContinuation.portaFrac);
                             }
-                            synth.voices[i].attack();
+                            v.attack();
 
-                            synth.addToVoiceList(&synth.voices[i]);
+                            synth.addToVoiceList(&v);
 
                             made++;
                             lastStart = i + 1;
@@ -265,17 +297,20 @@ struct Synth
         void setMIDIPitchBend(int16_t c, int16_t v)
         {
             auto val = (v - 8192) * 1.0 / 8192;
-            synth.midiCCLagCollection.setTarget(129, val, &synth.monoValues.pitchBend);
+            synth.midiCCLags.setTarget(synth.midiCCLagSlots[129], &synth.monoValues.pitchBend,
+                                       val);
         }
         void setMIDI1CC(int16_t ch, int16_t cc, int8_t v)
         {
             synth.monoValues.midiCC[cc] = v;
             // synth.monoValues.midiCCFloat[cc] = v / 127.0;
-            synth.midiCCLagCollection.setTarget(cc, v / 127.0, &synth.monoValues.midiCCFloat[cc]);
+            synth.midiCCLags.setTarget(synth.midiCCLagSlots[cc], &synth.monoValues.midiCCFloat[cc],
+                                       v / 127.0);
         }
         void setMIDIChannelPressure(int16_t ch, int16_t v)
         {
-            synth.midiCCLagCollection.setTarget(128, v / 127.0, &synth.monoValues.channelAT);
+            synth.midiCCLags.setTarget(synth.midiCCLagSlots[128], &synth.monoValues.channelAT,
+                                       v / 127.0);
             synth.monoValues.channelAT = v / 127.0;
         }
     };
@@ -309,7 +344,6 @@ struct Synth
     {
         enum Action : uint32_t
         {
-            UPDATE_PARAM,
             UPDATE_VU,
             UPDATE_VOICE_COUNT,
             SET_PATCH_NAME,
@@ -321,6 +355,20 @@ struct Synth
         float value{0}, value2{0};
         const char *patchNamePointer{0};
     };
+    /*
+     * Every value of a patch in patch.params order. A load builds one on the main thread
+     * and sends it as a single message rather than a message per param; the audio thread
+     * copies it in and pushes it onto retiredSnapshots for the main thread to free.
+     */
+    struct PatchSnapshot
+    {
+        std::vector<float> values;
+        PatchSnapshot *next{nullptr};
+    };
+    std::atomic<PatchSnapshot *> retiredSnapshots{nullptr};
+    void applyPatchSnapshot(PatchSnapshot *);
+    void reclaimPatchSnapshots();
+
     struct MainToAudioMsg
     {
         enum Action : uint32_t
@@ -337,38 +385,48 @@ struct Synth
             SEND_POST_LOAD,
             SEND_REQUEST_RESCAN,
             EDITOR_ATTACH_DETATCH, // paramid is true for attach and false for detach
-            SEND_PREP_FOR_STREAM,
-            PANIC_STOP_VOICES
+            PANIC_STOP_VOICES,
+            APPLY_PATCH_SNAPSHOT
         } action;
         uint32_t paramId{0};
         float value{0};
         const char *uiManagedPointer{nullptr};
+        PatchSnapshot *snapshot{nullptr};
     };
     using audioToUIQueue_t = sst::cpputils::SimpleRingBuffer<AudioToUIMsg, 1024 * 16>;
     using mainToAudioQueue_T = sst::cpputils::SimpleRingBuffer<MainToAudioMsg, 1024 * 64>;
     audioToUIQueue_t audioToUi;
+    // param values for the editor go here rather than through audioToUi
+    UIParamMirror uiParams;
     mainToAudioQueue_T mainToAudio;
     std::atomic<bool> doFullRefresh{false};
     bool isEditorAttached{false};
     sst::basic_blocks::dsp::UIComponentLagHandler lagHandler;
 
-    std::atomic<bool> readyForStream{false};
-    void prepForStream()
-    {
-        if (lagHandler.active)
-            lagHandler.instantlySnap();
-
-        for (auto &p : paramLagSet)
-        {
-            p.lag.snapToTarget();
-            p.value = p.lag.v;
-        }
-        paramLagSet.removeAll();
-
-        patch.dirty = false;
-        doFullRefresh = true;
-        readyForStream = true;
-    }
+    /*
+     * A seqlock copy of every value (in patch.params order) and the name. The audio thread
+     * republishes it when the patch changes so stateSave can read a consistent patch on
+     * the main thread without waiting on a process call. Lagging params publish their
+     * target. While a UI drag is still lagging we republish every statePublishInterval
+     * blocks and stay stale until it lands.
+     *
+     * The copy is behind while messages sit in mainToAudio or stateStale is set. stateSave
+     * then either asks the audio thread to publish (statePublishRequested, cleared once
+     * done) or, with the plugin inactive, catches up on the main thread.
+     */
+    std::atomic<uint32_t> stateSeq{0};
+    std::unique_ptr<std::atomic<float>[]> stateValues;
+    std::array<std::atomic<char>, sizeof(Patch::name)> stateName;
+    std::atomic<bool> stateStale{true};
+    std::atomic<bool> statePublishRequested{false};
+    static constexpr uint32_t statePublishInterval{256};
+    uint32_t blocksSinceStatePublish{0};
+    void publishStateIfStale();
+    void publishState();
+    void readPublishedState(std::vector<float> &values, std::string &name) const;
+    bool publishedStateIsBehind() const;
+    // main thread, only while nothing runs the engine; true if anything was pending
+    bool publishPendingStateWhileInactive();
 
     void pushFullUIRefresh();
     void postLoad()
@@ -376,11 +434,9 @@ struct Synth
         doFullRefresh = true;
         reapplyControlSettings();
         resetSoloState();
+        renderPlanDirty = true;
 
-        for (auto &[i, p] : patch.paramMap)
-        {
-            p->lag.snapTo(p->value);
-        }
+        paramLags.stopAll();
     }
 
     std::atomic<bool> onMainRescanParams{false};
@@ -389,7 +445,16 @@ struct Synth
     void reapplyControlSettings();
     void resetSoloState();
 
-    sst::cpputils::active_set_overlay<Param> paramLagSet;
+    // set when a RENDER_PLAN param moves; the patch plan is rebuilt before the next block
+    // or the next voice attack, whichever comes first
+    std::atomic<bool> renderPlanDirty{false};
+    void decodeRenderPlanIfDirty()
+    {
+        if (renderPlanDirty.exchange(false))
+            patch.decodeRenderPlan();
+    }
+
+    LagBank paramLags;
 
     sst::basic_blocks::dsp::VUPeak vuPeak;
     int32_t updateVuEvery{(int32_t)(48000 * 2.5 / 60 / blockSize)}; // approx
@@ -0,0 +1,91 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#ifndef BACONPAUL_SIX_SINES_SYNTH_UI_PARAM_MIRROR_H
+#define BACONPAUL_SIX_SINES_SYNTH_UI_PARAM_MIRROR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace baconpaul::six_sines
+{
+/*
+ * The param values the editor should show, in Patch::params order, with a bit per param
+ * set when it changes. The audio thread stores and sets bits; the editor takes the bits
+ * once a frame and reads just those values. However dense the automation, each frame costs
+ * the editor one look per changed param and nothing queues up behind it.
+ *
+ * A value stored after the editor took its bit sets the bit again, so the editor might see
+ * the newer value a frame early but never misses the last one.
+ */
+struct UIParamMirror
+{
+    // main thread, before audio runs
+    void resize(size_t n)
+    {
+        words = (n + 63) / 64;
+        values = std::make_unique<std::atomic<float>[]>(n);
+        dirty = std::make_unique<std::atomic<uint64_t>[]>(words);
+        for (size_t i = 0; i < n; ++i)
+            values[i].store(0.f, std::memory_order_relaxed);
+        for (size_t w = 0; w < words; ++w)
+            dirty[w].store(0, std::memory_order_relaxed);
+    }
+
+    // audio thread
+    void set(size_t index, float v)
+    {
+        values[index].store(v, std::memory_order_relaxed);
+        dirty[index / 64].fetch_or(uint64_t(1) << (index % 64), std::memory_order_release);
+    }
+
+    // editor thread; f(index, value) for each param changed since the last take
+    template <typename F> void takeChanged(F &&f)
+    {
+        for (size_t w = 0; w < words; ++w)
+        {
+            if (dirty[w].load(std::memory_order_relaxed) == 0)
+                continue;
+
+            auto bits = dirty[w].exchange(0, std::memory_order_acquire);
+            while (bits)
+            {
+                auto b = lowestBit(bits);
+                bits &= bits - 1;
+                auto idx = w * 64 + b;
+                f(idx, values[idx].load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+  private:
+    size_t words{0};
+    std::unique_ptr<std::atomic<float>[]> values;
+    std::unique_ptr<std::atomic<uint64_t>[]> dirty;
+
+    static size_t lowestBit(uint64_t v)
+    {
+        size_t res{0};
+        while (!(v & 1))
+        {
+            v >>= 1;
+            res++;
+        }
+        return res;
+    }
+};
+} // namespace baconpaul::six_sines
+#endif // UI_PARAM_MIRROR_H
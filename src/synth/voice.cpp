@@ -13,18 +13,20 @@
  * The source code and license are at https://github.com/baconpaul/six-sines
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "voice.h"
 #include "sst/cpputils/constructors.h"
 #include "synth/matrix_index.h"
 #include "synth/patch.h"
-#include "libMTSClient.h"
 
 namespace baconpaul::six_sines
 {
 
 namespace scpu = sst::cpputils;
 
-Voice::Voice(const Patch &p, MonoValues &mv)
+Voice::Voice(const Patch &p, MonoValues &mv, uint32_t seed)
     : monoValues(mv), out(p.output, p.mainPanMod, p.fineTuneMod, mixerNode, mv, voiceValues),
       output{out.output[0], out.output[1]},
       src(scpu::make_array_lambda<OpSource, numOps>(
@@ -42,14 +44,16 @@ Voice::Voice(const Patch &p, MonoValues &mv)
                                     this->sourceAtMatrix(i), mv, voiceValues);
           }))
 {
+    voiceValues.lfoRng.reseed(seed);
     std::fill(isKeytrack.begin(), isKeytrack.end(), true);
     std::fill(cmRatio.begin(), cmRatio.end(), 1.f);
 }
 
 void Voice::attack()
 {
+    silentBlocks = 0;
+    voiceValues.velocityLag = monoValues.velocityLag;
     voiceValues.velocityLag.snapTo(voiceValues.velocity);
-    voiceValues.velocityLag.setRateInMilliseconds(10, monoValues.sr.sampleRate, 1.0 / blockSize);
 
     out.attack();
     for (auto &n : mixerNode)
@@ -67,16 +71,17 @@ void Voice::attack()
 void Voice::renderBlock()
 {
     float retuneKey = voiceValues.key;
-    if (monoValues.mtsClient && MTS_HasMaster(monoValues.mtsClient))
+    if (monoValues.mtsHasMaster)
     {
-        retuneKey +=
-            MTS_RetuningInSemitones(monoValues.mtsClient, voiceValues.key, voiceValues.channel);
+        retuneKey += monoValues.mtsRetuning[voiceValues.channel & 15][voiceValues.key & 127];
     }
-    retuneKey += ((monoValues.pitchBend >= 0) ? out.bendUp : out.bendDown) * monoValues.pitchBend;
+    const auto &outP = out.outputNode;
+    retuneKey += ((monoValues.pitchBend >= 0) ? outP.bendUp.value : outP.bendDown.value) *
+                 monoValues.pitchBend;
     retuneKey += voiceValues.portaDiff * voiceValues.portaSign + voiceValues.mpeBendInSemis +
                  voiceValues.noteExpressionTuningInSemis;
-    retuneKey += out.fineTune * 0.01 + out.ftModNode.coarseTune + out.ftModNode.level * 2 +
-                 out.ftModNode.coarseLevel;
+    retuneKey += outP.fineTune.value * 0.01 + out.ftModNode.modNode.coarseTune.value +
+                 out.ftModNode.level * 2 + out.ftModNode.coarseLevel;
 
     if (voiceValues.portaDiff > 1e-5)
     {
@@ -89,9 +94,6 @@ void Voice::renderBlock()
         voiceValues.portaFrac = 0;
     }
 
-    auto octSh = std::clamp((int)std::round(out.octTranspose), -3, 3);
-    static constexpr float octFac[7] = {1.0 / 8.0, 1.0 / 4.0, 1.0 / 2.0, 1.0, 2.0, 4.0, 8.0};
-
     auto baseFreq = monoValues.tuningProvider.note_to_pitch(retuneKey - 69) * 440.0;
 
     voiceValues.velocityLag.setTarget(voiceValues.velocity);
@@ -105,9 +107,8 @@ void Voice::renderBlock()
             continue;
         }
         src[i].zeroInputs();
-        auto octPer = std::clamp((int)std::round(src[i].octTranspose), -3, 3);
-
-        src[i].setBaseFrequency(baseFreq, octFac[octSh + 3] * octFac[octPer + 3]);
+        src[i].setBaseFrequency(baseFreq,
+                                outP.plan.octaveFactor * src[i].sourceNode.plan.octaveFactor);
         for (auto j = 0; j < i; ++j)
         {
             auto pos = MatrixIndex::positionForSourceTarget(j, i);
@@ -120,6 +121,9 @@ void Voice::renderBlock()
 
     out.renderBlock();
 
+    if (monoValues.silentVoiceFloor > 0.f && fadeBlocks < 0)
+        checkForSilence();
+
     if (fadeBlocks > 0)
     {
         for (int i = 0; i < blockSize; ++i)
@@ -134,6 +138,46 @@ void Voice::renderBlock()
     }
 }
 
+void Voice::checkForSilence()
+{
+    float peak{0.f};
+    for (int i = 0; i < blockSize; ++i)
+        peak = std::max({peak, std::fabs(out.output[0][i]), std::fabs(out.output[1][i])});
+
+    // only released voices are candidates; a held key keeps its voice however quiet
+    if (voiceValues.gated || peak >= monoValues.silentVoiceFloor || envelopeYetToSound())
+    {
+        silentBlocks = 0;
+        return;
+    }
+
+    // quiet for long enough; fade out and let the synth end us like a stolen voice
+    if (++silentBlocks >= monoValues.silentVoiceBlocks)
+        fadeBlocks = fadeOverBlocks;
+}
+
+bool Voice::envelopeYetToSound() const
+{
+    // A voice in an envelope delay or waiting for its release trigger is quiet but not done
+    auto pending = [this](const auto &n)
+    {
+        if (!n.active || n.constantEnv)
+            return false;
+        if (n.triggerMode == ON_RELEASE && voiceValues.gated)
+            return true;
+        return n.env.stage < n.env.s_decay;
+    };
+    for (int i = 0; i < numOps; ++i)
+    {
+        if (pending(src[i]) || pending(selfNode[i]) || pending(mixerNode[i]))
+            return true;
+    }
+    for (const auto &n : matrixNode)
+        if (pending(n))
+            return true;
+    return pending(out);
+}
+
 static_assert(numOps == 6, "Rebuild this table if not");
 
 OpSource &Voice::sourceAtMatrix(size_t pos) { return src[MatrixIndex::sourceIndexAt(pos)]; }
@@ -234,6 +278,7 @@ void Voice::cleanup()
 {
     used = false;
     fadeBlocks = -1;
+    silentBlocks = 0;
     voiceValues.setGated(false);
     voiceValues.portaDiff = 0;
     voiceValues.portaFrac = 0;
@@ -267,6 +312,64 @@ void Voice::cleanup()
     out.panModNode.envCleanup();
 }
 
+void Voice::bindAsMonoModulationVoice()
+{
+    auto monoOnly = [](auto &n) { n.bindsMonoOnly = true; };
+    for (auto &n : src)
+        monoOnly(n);
+    for (auto &n : selfNode)
+        monoOnly(n);
+    for (auto &n : matrixNode)
+        monoOnly(n);
+    for (auto &n : mixerNode)
+        monoOnly(n);
+    monoOnly(out);
+    monoOnly(out.panModNode);
+    monoOnly(out.ftModNode);
+
+    // this one is made before audio starts and never attacked, so set its sources up now,
+    // after the flags above so the reset binds only the mono routes
+    for (auto &n : src)
+        n.reset();
+}
+
+void Voice::useMonoModulationFrom(const Voice &mono)
+{
+    for (int i = 0; i < numOps; ++i)
+    {
+        src[i].monoNode = &mono.src[i];
+        selfNode[i].monoNode = &mono.selfNode[i];
+        mixerNode[i].monoNode = &mono.mixerNode[i];
+    }
+    for (int i = 0; i < matrixSize; ++i)
+    {
+        matrixNode[i].monoNode = &mono.matrixNode[i];
+    }
+    out.monoNode = &mono.out;
+    out.panModNode.monoNode = &mono.out.panModNode;
+    out.ftModNode.monoNode = &mono.out.ftModNode;
+}
+
+void Voice::calculateMonoModulation()
+{
+    auto calc = [](auto &n)
+    {
+        n.bindModulation();
+        n.calculateModulation();
+    };
+    for (auto &n : src)
+        calc(n);
+    for (auto &n : selfNode)
+        calc(n);
+    for (auto &n : matrixNode)
+        calc(n);
+    for (auto &n : mixerNode)
+        calc(n);
+    calc(out);
+    calc(out.panModNode);
+    calc(out.ftModNode);
+}
+
 void Voice::setupPortaTo(uint16_t newKey, float log2Time)
 {
     if (log2Time < -8 + 1e-5)
@@ -34,13 +34,19 @@ struct Voice
     const MonoValues &monoValues;
     VoiceValues voiceValues;
 
-    Voice(const Patch &, MonoValues &);
+    // main thread; seed starts this voice's lfoRng
+    Voice(const Patch &, MonoValues &, uint32_t seed);
     ~Voice() = default;
 
     void attack();
     void renderBlock();
     void cleanup();
 
+    // The synth keeps one voice for the mono modulation pass; see ModulationSupport::monoNode
+    void bindAsMonoModulationVoice();
+    void useMonoModulationFrom(const Voice &mono);
+    void calculateMonoModulation();
+
     bool used{false};
 
     std::array<OpSource, numOps> src;
@@ -64,6 +70,10 @@ struct Voice
     float dFade{1.0 / (blockSize * fadeOverBlocks)};
     int32_t fadeBlocks{-1};
 
+    int32_t silentBlocks{0};
+    void checkForSilence();
+    bool envelopeYetToSound() const;
+
     OutputNode out;
 
     Voice *prior{nullptr}, *next{nullptr};
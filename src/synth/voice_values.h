@@ -19,6 +19,7 @@
 #include <sst/basic-blocks/tables/EqualTuningProvider.h>
 #include <sst/basic-blocks/tables/TwoToTheXProvider.h>
 #include "sst/basic-blocks/dsp/Lag.h"
+#include "sst/basic-blocks/dsp/RNG.h"
 
 struct MTSClient;
 
@@ -65,6 +66,10 @@ struct VoiceValues
 
     sst::basic_blocks::dsp::OnePoleLag<float, false> velocityLag;
 
+    // The voice's own stream for its LFOs. Voices are built on the main thread while audio
+    // runs and an LFO draws as it is made, so they can't share MonoValues::rng
+    mutable sst::basic_blocks::dsp::RNG lfoRng;
+
   private:
     bool gatedV{false};
     int keyV{0};
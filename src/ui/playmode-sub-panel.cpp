@@ -192,6 +192,13 @@ PlayModeSubPanel::PlayModeSubPanel(SixSinesEditor &e) : HasEditor(e)
     srStratLab->setText("Oversampling");
     addAndMakeVisible(*srStratLab);
 
+    createComponent(editor, *this, editor.patchCopy.output.silentVoiceFloor, silentFloor,
+                    silentFloorD);
+    addAndMakeVisible(*silentFloor);
+    silentFloorLab = std::make_unique<jcmp::RuledLabel>();
+    silentFloorLab->setText("Silent Voices");
+    addAndMakeVisible(*silentFloorLab);
+
     setEnabledState();
 }
 
@@ -252,6 +259,8 @@ void PlayModeSubPanel::resized()
     rsl.add(titleLabelGaplessLayout(srStratLab));
     rsl.add(jlo::Component(*srStrat).withHeight(uicLabelHeight));
     rsl.add(jlo::Component(*rsEng).withHeight(uicLabelHeight));
+    rsl.add(titleLabelGaplessLayout(silentFloorLab));
+    rsl.add(jlo::Component(*silentFloor).withHeight(uicLabelHeight));
     lo.add(rsl);
 
     lo.doLayout();
@@ -396,7 +405,7 @@ void PlayModeSubPanel::showPolyLimitMenu()
     p.addSectionHeader("Voice Limit");
     p.addSeparator();
     auto currentLimit = getPolyLimit();
-    for (auto lim : {4, 6, 8, 12, 16, 24, 32, 48, 64})
+    for (auto lim : {4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256})
     {
         p.addItem(std::to_string(lim), true, lim == currentLimit,
                   [w = juce::Component::SafePointer(this), lim]()
@@ -91,6 +91,10 @@ struct PlayModeSubPanel : juce::Component, HasEditor
     std::unique_ptr<jcmp::JogUpDownButton> rsEng;
     std::unique_ptr<PatchDiscrete> rsEngD;
 
+    std::unique_ptr<jcmp::RuledLabel> silentFloorLab;
+    std::unique_ptr<jcmp::JogUpDownButton> silentFloor;
+    std::unique_ptr<PatchDiscrete> silentFloorD;
+
     void showPolyLimitMenu();
     int getPolyLimit();
     void setPolyLimit(int pl);
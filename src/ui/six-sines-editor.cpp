@@ -54,9 +54,9 @@ namespace jstl = sst::jucegui::style;
 using sheet_t = jstl::StyleSheet;
 static constexpr sheet_t::Class PatchMenu("six-sines.patch-menu");
 
-SixSinesEditor::SixSinesEditor(Synth::audioToUIQueue_t &atou, Synth::mainToAudioQueue_T &utoa,
-                               const clap_host_t *h)
-    : jcmp::WindowPanel(true), audioToUI(atou), mainToAudio(utoa), clapHost(h)
+SixSinesEditor::SixSinesEditor(Synth::audioToUIQueue_t &atou, UIParamMirror &uip,
+                               Synth::mainToAudioQueue_T &utoa, const clap_host_t *h)
+    : jcmp::WindowPanel(true), audioToUI(atou), uiParams(uip), mainToAudio(utoa), clapHost(h)
 {
     setTitle("Six Sines - an Audio Rate Modulation Synthesizer");
     setAccessible(true);
@@ -133,6 +133,8 @@ SixSinesEditor::SixSinesEditor(Synth::audioToUIQueue_t &atou, Synth::mainToAudio
         this->postPatchChange(s);
         repaint();
     };
+    // the preset list can shift under the current one, so find it again
+    presetManager->onUserPresetsChanged = [this]() { setPatchNameDisplay(); };
 
     presetDataBinding = std::make_unique<PresetDataBinding>(*presetManager, patchCopy, mainToAudio);
     presetDataBinding->setStateForDisplayName(patchCopy.name);
@@ -180,14 +182,17 @@ SixSinesEditor::~SixSinesEditor()
 
 void SixSinesEditor::idle()
 {
+    // the user tree is walked on a worker; this only applies what it found
+    presetManager->refreshUserPresets();
+
+    // each param which moved since the last frame, however often it moved
+    uiParams.takeChanged([this](auto idx, auto val)
+                         { setAndSendParamValue(patchCopy.params[idx]->meta.id, val, false); });
+
     auto aum = audioToUI.pop();
     while (aum.has_value())
     {
-        if (aum->action == Synth::AudioToUIMsg::UPDATE_PARAM)
-        {
-            setAndSendParamValue(aum->paramId, aum->value, false);
-        }
-        else if (aum->action == Synth::AudioToUIMsg::UPDATE_VU)
+        if (aum->action == Synth::AudioToUIMsg::UPDATE_VU)
         {
             vuMeter->setLevels(aum->value, aum->value2);
         }
@@ -521,6 +526,83 @@ struct MenuValueTypein : HasEditor, juce::PopupMenu::CustomComponent, juce::Text
     void textEditorEscapeKeyPressed(juce::TextEditor &) override { triggerMenuItem(); }
 };
 
+struct MenuPresetSearch : HasEditor, juce::PopupMenu::CustomComponent, juce::TextEditor::Listener
+{
+    std::unique_ptr<juce::TextEditor> textEditor;
+
+    MenuPresetSearch(SixSinesEditor &editor)
+        : juce::PopupMenu::CustomComponent(false), HasEditor(editor)
+    {
+        textEditor = std::make_unique<juce::TextEditor>();
+        textEditor->setWantsKeyboardFocus(true);
+        textEditor->addListener(this);
+        textEditor->setIndents(2, 0);
+        textEditor->setTextToShowWhenEmpty("Search (try 'bass ops:3 fm:ring')",
+                                           juce::Colours::grey);
+
+        addAndMakeVisible(*textEditor);
+    }
+
+    void getIdealSize(int &w, int &h) override
+    {
+        w = 240;
+        h = 22;
+    }
+    void resized() override { textEditor->setBounds(getLocalBounds().reduced(3, 1)); }
+
+    void visibilityChanged() override
+    {
+        juce::Timer::callAfterDelay(
+            2,
+            [this]()
+            {
+                if (textEditor->isVisible())
+                    textEditor->grabKeyboardFocus();
+            });
+    }
+
+    void textEditorReturnKeyPressed(juce::TextEditor &ed) override
+    {
+        auto s = ed.getText().toStdString();
+        triggerMenuItem();
+        if (s.empty())
+            return;
+
+        // let this menu close before opening the results
+        juce::Timer::callAfterDelay(1,
+                                    [w = juce::Component::SafePointer(&editor), s]()
+                                    {
+                                        if (w)
+                                            w->showPresetSearchResults(s);
+                                    });
+    }
+    void textEditorEscapeKeyPressed(juce::TextEditor &) override { triggerMenuItem(); }
+};
+
+void SixSinesEditor::showPresetSearchResults(const std::string &query)
+{
+    auto res = presetManager->searchPresets(query, maxPresetSearchResults);
+
+    auto p = juce::PopupMenu();
+    p.addSectionHeader("Presets matching '" + query + "'");
+    p.addSeparator();
+    if (res.empty())
+        p.addItem("No presets match", false, false, []() {});
+
+    for (const auto *r : res)
+    {
+        p.addItem(r->label,
+                  [w = juce::Component::SafePointer(this), idx = r->index]()
+                  {
+                      if (!w)
+                          return;
+                      w->presetDataBinding->setValueFromGUI(idx + 1);
+                      w->presetButton->repaint();
+                  });
+    }
+    p.showMenuAsync(juce::PopupMenu::Options().withParentComponent(this));
+}
+
 void SixSinesEditor::popupMenuForContinuous(jcmp::ContinuousParamEditor *e)
 {
     auto data = e->continuous();
@@ -562,6 +644,7 @@ void SixSinesEditor::showPresetPopup()
 {
     auto p = juce::PopupMenu();
     p.addSectionHeader("Main Menu");
+    p.addCustomItem(-1, std::make_unique<MenuPresetSearch>(*this));
 
     auto f = juce::PopupMenu();
     for (auto &[c, ent] : presetManager->factoryPatchNames)
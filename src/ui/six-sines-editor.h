@@ -63,11 +63,12 @@ struct SixSinesEditor : jcmp::WindowPanel
     ModMatrixConfig modMatrixConfig;
 
     Synth::audioToUIQueue_t &audioToUI;
+    UIParamMirror &uiParams;
     Synth::mainToAudioQueue_T &mainToAudio;
     const clap_host_t *clapHost{nullptr};
 
-    SixSinesEditor(Synth::audioToUIQueue_t &atou, Synth::mainToAudioQueue_T &utoa,
-                   const clap_host_t *ch);
+    SixSinesEditor(Synth::audioToUIQueue_t &atou, UIParamMirror &uip,
+                   Synth::mainToAudioQueue_T &utoa, const clap_host_t *ch);
     virtual ~SixSinesEditor();
 
     std::unique_ptr<sst::jucegui::style::LookAndFeelManager> lnf;
@@ -107,6 +108,8 @@ struct SixSinesEditor : jcmp::WindowPanel
     std::unique_ptr<PresetDataBinding> presetDataBinding;
     std::unique_ptr<jcmp::JogUpDownButton> presetButton;
     void showPresetPopup();
+    void showPresetSearchResults(const std::string &query);
+    static constexpr size_t maxPresetSearchResults{64};
     void doLoadPatch();
     void doSavePatch();
     void postPatchChange(const std::string &displayName);
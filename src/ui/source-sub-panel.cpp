@@ -122,6 +122,10 @@ void SourceSubPanel::setSelectedIndex(size_t idx)
     };
     traverse(wavButton);
 
+    createComponent(editor, *this, sn.interpolation, interpButton, interpButtonD);
+    addAndMakeVisible(*interpButton);
+    traverse(interpButton);
+
     createComponent(editor, *this, sn.startingPhase, startingPhase, startingPhaseD);
     addAndMakeVisible(*startingPhase);
     traverse(startingPhase);
@@ -246,7 +250,10 @@ void SourceSubPanel::resized()
     ktl.add(sktcol);
 
     ktl.add(titleLabelGaplessLayout(wavTitle));
-    ktl.add(jlo::Component(*wavButton).withHeight(uicLabelHeight));
+    auto wl = jlo::HList().withHeight(uicLabelHeight).withAutoGap(uicMargin);
+    wl.add(jlo::Component(*wavButton).expandToFill());
+    wl.add(jlo::Component(*interpButton).withWidth(50));
+    ktl.add(wl);
     ktl.add(sideLabelSlider(startingPhaseL, startingPhase));
     ktl.add(jlo::Component(*wavPainter).withHeight(uicLabelHeight * 1.8));
 
@@ -62,6 +62,9 @@ struct SourceSubPanel : juce::Component,
     std::unique_ptr<jcmp::JogUpDownButton> wavButton;
     std::unique_ptr<PatchDiscrete> wavButtonD;
 
+    std::unique_ptr<jcmp::JogUpDownButton> interpButton;
+    std::unique_ptr<PatchDiscrete> interpButtonD;
+
     std::unique_ptr<jcmp::RuledLabel> modTitle, lfoModTitle, wavTitle, keyTrackTitle;
 
     std::unique_ptr<juce::Component> wavPainter;
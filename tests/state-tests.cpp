@@ -0,0 +1,109 @@
+/*
+ * Six Sines
+ *
+ * A synth with audio rate modulation.
+ *
+ * Copyright 2024-2025, Paul Walker and Various authors, as described in the github
+ * transaction log.
+ *
+ * This source repo is released under the MIT license, but has
+ * GPL3 dependencies, as such the combined work will be
+ * released under GPL3.
+ *
+ * The source code and license are at https://github.com/baconpaul/six-sines
+ */
+
+#include <cstring>
+#include <iostream>
+#include "synth/synth.h"
+#include "synth/patch.h"
+#include "presets/preset-manager.h"
+
+using namespace baconpaul::six_sines;
+
+namespace
+{
+int failures{0};
+
+void check(bool ok, const std::string &what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+// enough of a host for sendValuesToAudio, which only asks for extensions
+clap_host_t testHost()
+{
+    clap_host_t h;
+    memset(&h, 0, sizeof(h));
+    h.clap_version = CLAP_VERSION;
+    h.name = "six-sines-tests";
+    h.vendor = "six-sines";
+    h.url = "";
+    h.version = "0";
+    h.get_extension = [](const clap_host_t *, const char *) -> const void * { return nullptr; };
+    h.request_restart = [](const clap_host_t *) {};
+    h.request_process = [](const clap_host_t *) {};
+    h.request_callback = [](const clap_host_t *) {};
+    return h;
+}
+
+// A host saving a plugin it never processed, straight after loading state into it, has to
+// get the loaded state back
+void loadThenSaveWithoutProcess()
+{
+    auto host = testHost();
+    Synth synth(false);
+
+    Patch loaded;
+    std::vector<float> values;
+    for (auto *p : loaded.params)
+    {
+        if (p->meta.type == md_t::FLOAT)
+            p->value = p->meta.minVal + 0.37f * (p->meta.maxVal - p->meta.minVal);
+        values.push_back(p->value);
+    }
+    auto expected = values;
+
+    presets::PresetManager::sendValuesToAudio(std::move(values), synth.mainToAudio,
+                                              "Loaded Patch", &host);
+
+    // this is what stateSave does while the plugin is inactive
+    check(synth.publishedStateIsBehind(), "a queued load leaves the published state behind");
+    check(synth.publishPendingStateWhileInactive(), "the pending load is published");
+    check(!synth.publishedStateIsBehind(), "nothing is pending after publishing");
+
+    std::vector<float> saved;
+    std::string name;
+    synth.readPublishedState(saved, name);
+    check(name == "Loaded Patch", "the loaded name is saved, got '" + name + "'");
+    check(saved.size() == expected.size(), "every param is saved");
+    for (size_t i = 0; i < std::min(saved.size(), expected.size()); ++i)
+        check(saved[i] == expected[i], "value of " + loaded.params[i]->meta.name);
+
+    // and it round trips through the session format
+    auto state = synth.patch.toBinaryState(saved, name.c_str());
+    std::vector<float> reread;
+    std::string rereadName;
+    check(Patch::binaryStateToValues(state, reread, rereadName), "binary state reads back");
+    check(reread == expected && rereadName == name, "binary state holds the loaded patch");
+
+    synth.onMainThread();
+}
+} // namespace
+
+int main()
+{
+    loadThenSaveWithoutProcess();
+
+    if (failures)
+    {
+        std::cerr << failures << " failures" << std::endl;
+        return 1;
+    }
+    std::cout << "All state tests passed" << std::endl;
+    return 0;
+}